@@ -0,0 +1,220 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// stdc++
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+
+// application
+#include "require.hpp"
+#include "task_queue.hpp"
+
+/******************************************************************************/
+// Heap allocations, counted across the whole process while a check has asked.
+// This replaces the global allocator, which is why it is its own executable
+// and never linked into the client.
+
+namespace {
+
+std::atomic<bool>        counting_s{false};
+std::atomic<std::size_t> allocations_s{0};
+
+void* allocate(std::size_t size) noexcept {
+    if (counting_s.load(std::memory_order_relaxed))
+        allocations_s.fetch_add(1, std::memory_order_relaxed);
+
+    return std::malloc(size ? size : 1);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* result = allocate(size))
+        return result;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+template <typename F>
+std::size_t allocations(F f) {
+    std::size_t before = allocations_s.load();
+
+    counting_s = true;
+
+    f();
+
+    counting_s = false;
+
+    return allocations_s.load() - before;
+}
+
+/******************************************************************************/
+// Tasks: a closure copied into a heap-allocated std::function on a
+// heap-allocated node (as task_queue_t used to), vs. moved into a task_t and
+// on into another (as into and out of an injection queue cell.) Then the
+// same closures through a real pool, pushed from outside and pushed by the
+// worker itself, which once warmed up must not allocate at all. The pool has
+// the one worker, so nodes aren't stolen off to another worker's spares.
+
+struct closure_t {
+    void operator()() const {
+        ran_m->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::size_t>* ran_m;
+    std::size_t               payload_m[2]; // for the rest of a typical closure's captures
+};
+
+struct chain_t {
+    void operator()() const {
+        ran_m->fetch_add(1, std::memory_order_relaxed);
+
+        if (left_m)
+            queue_m->push(chain_t{queue_m, ran_m, left_m - 1});
+    }
+
+    task_queue_t*             queue_m;
+    std::atomic<std::size_t>* ran_m;
+    std::size_t               left_m;
+};
+
+void check_tasks(std::size_t iterations, std::ostream& out) {
+    typedef std::function<void ()> legacy_t;
+    typedef task_queue_t::task_t   task_t;
+
+    std::atomic<std::size_t> ran{0};
+
+    std::size_t legacy_allocations = allocations([&](){
+        for (std::size_t i(0); i < iterations; ++i) {
+            std::unique_ptr<legacy_t> task(new legacy_t(closure_t{&ran, { i, i }}));
+
+            (*task)();
+        }
+    });
+
+    std::size_t task_allocations = allocations([&](){
+        for (std::size_t i(0); i < iterations; ++i) {
+            task_t task(closure_t{&ran, { i, i }});
+            task_t taken(std::move(task));
+
+            taken();
+        }
+    });
+
+    task_queue_t queue(1);
+
+    auto drain = [&](std::size_t count) {
+        while (ran.load() < count)
+            std::this_thread::yield();
+    };
+
+    auto push = [&](std::size_t count) {
+        std::size_t until = ran.load() + count;
+
+        for (std::size_t i(0); i < count; ++i) {
+            queue.push(closure_t{&ran, { i, i }});
+        }
+
+        drain(until);
+    };
+
+    auto chain = [&](std::size_t count) {
+        std::size_t until = ran.load() + count;
+
+        queue.push(chain_t{&queue, &ran, count - 1});
+
+        drain(until);
+    };
+
+    // The first time through grows the deque and fills the spares.
+    push(iterations);
+    chain(iterations);
+
+    std::size_t push_allocations = allocations([&](){ push(iterations); });
+    std::size_t chain_allocations = allocations([&](){ chain(iterations); });
+
+    out << "BNCH : TASK : ALOC : OLD : " << static_cast<double>(legacy_allocations) / iterations
+        << " : NEW : " << static_cast<double>(task_allocations) / iterations
+        << " : PUSH : " << static_cast<double>(push_allocations) / iterations
+        << " : CHAN : " << static_cast<double>(chain_allocations) / iterations
+        << " per task\n";
+
+    require(task_allocations == 0);
+    require(push_allocations == 0);
+    require(chain_allocations == 0);
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+int main(int argc, char** argv) try {
+    std::size_t iterations = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+    check_tasks(iterations, std::cout);
+
+    return 0;
+} catch (const std::exception& error) {
+    std::cerr << "Fatal error : " << error.what() << '\n';
+
+    return 1;
+} catch (...) {
+    std::cerr << "Fatal error : Unknown" << '\n';
+
+    return 1;
+}
+
+/******************************************************************************/
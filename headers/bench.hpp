@@ -0,0 +1,41 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef bench_hpp__
+#define bench_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <iosfwd>
+#include <string>
+
+/******************************************************************************/
+
+namespace bench {
+
+/******************************************************************************/
+
+// Micro-benchmarks of hot paths, run from the console. Each compares the
+// current implementation against the one it replaced. Returns false iff there
+// is no benchmark by that name. An iterations of zero picks a default.
+bool run(const std::string& name, std::size_t iterations, std::ostream& out);
+
+/******************************************************************************/
+
+// The names run() accepts, space-separated.
+std::string list();
+
+/******************************************************************************/
+
+} // namespace bench
+
+/******************************************************************************/
+
+#endif // bench_hpp__
+
+/******************************************************************************/
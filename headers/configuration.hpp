@@ -11,6 +11,7 @@
 /******************************************************************************/
 
 // stdc++
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -33,6 +34,14 @@ struct settings_t {
     std::string             stem_m;          // name of the settings file sans extension
     boost::filesystem::path bin_path_m;      // path to self
     std::string             api_key_m;       // stockfighter api key
+    bool                    http2_m{false};  // multiplex REST calls over HTTP/2
+    std::string             api_url_m{"https://api.stockfighter.io/ob/api/"}; // order book api base
+    std::string             gm_url_m{"https://www.stockfighter.io/gm/"};      // game master api base
+    std::uint64_t           sim_seed_m{0};   // simulator order flow seed
+    std::size_t             sim_events_m{0}; // events to simulate in place of the service (0: go live)
+    std::size_t             idle_spin_m{0};  // times an idle worker spins before yielding
+    std::size_t             idle_yield_m{0}; // times an idle worker yields before parking
+    std::size_t             hot_workers_m{0}; // workers kept spinning on the critical lane
 };
 
 /******************************************************************************/
@@ -14,7 +14,11 @@
 #include <curl/curl.h>
 
 // stdc++
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 // application
 #include "error.hpp"
@@ -85,6 +89,10 @@ public:
         setopt(CURLOPT_URL, str.c_str());
     }
 
+    void set_get() {
+        setopt(CURLOPT_HTTPGET, 1L);
+    }
+
     void set_post() {
         setopt(CURLOPT_POST, 1);
     }
@@ -101,6 +109,27 @@ public:
         setopt(CURLOPT_FOLLOWLOCATION, 1);
     }
 
+    // Negotiates HTTP/2 over TLS (falling back to HTTP/1.1 if the server won't
+    // speak it), and prefers waiting for a connection that can multiplex this
+    // request over opening another one.
+    void set_http2() {
+        setopt(CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+        setopt(CURLOPT_PIPEWAIT, 1L);
+    }
+
+    // true iff the libcurl we're linked against was built with HTTP/2.
+    static bool http2_supported() {
+        return curl_version_info(CURLVERSION_NOW)->features & CURL_VERSION_HTTP2;
+    }
+
+    // Keeps idle connections in this handle's cache from being silently
+    // dropped by intermediate hardware between requests.
+    void set_tcp_keepalive(long idle_seconds = 30, long interval_seconds = 15) {
+        setopt(CURLOPT_TCP_KEEPALIVE, 1L);
+        setopt(CURLOPT_TCP_KEEPIDLE, idle_seconds);
+        setopt(CURLOPT_TCP_KEEPINTVL, interval_seconds);
+    }
+
     void set_upload(std::string payload) {
         setopt(CURLOPT_UPLOAD, 1);
 
@@ -118,19 +147,58 @@ public:
     }
 
     const std::string& perform() {
+        prepare();
+
+        return finish(curl_easy_perform(curl_m));
+    }
+
+    // perform() in two halves, for transfers driven by curl_multi_t: prepare()
+    // before the handle is handed off, finish() with the transfer's result.
+    void prepare() {
         if (headers_m) {
             setopt(CURLOPT_HTTPHEADER, headers_m);
         }
+    }
 
-        curl_assert(curl_easy_perform(curl_m));
+    const std::string& finish(CURLcode code) {
+        curl_assert(code);
 
         long http_code(0);
         curl_easy_getinfo(curl_m, CURLINFO_RESPONSE_CODE, &http_code);
         response_code_m = http_code;
 
+        long connects(0);
+        curl_easy_getinfo(curl_m, CURLINFO_NUM_CONNECTS, &connects);
+        connects_m = connects;
+
+        performed_m = true;
+
         return result();
     }
 
+    // Clears the per-request state so the handle (and its connection cache)
+    // can be used for another request. Headers and options persist.
+    void reset() {
+        result_data_m.clear();
+        header_data_m.clear();
+        payload_data_m.clear();
+        payload_offset_m = 0;
+        response_code_m = 0;
+        connects_m = 0;
+        performed_m = false;
+    }
+
+    // true iff perform() has completed since the last reset().
+    bool performed() const {
+        return performed_m;
+    }
+
+    // The number of new connections the last perform() had to open. Zero means
+    // an existing connection was reused.
+    std::size_t connects() const {
+        return connects_m;
+    }
+
     std::size_t response_code() const {
         return response_code_m;
     }
@@ -143,6 +211,10 @@ public:
         return result_data_m;
     }
 
+    CURL* native_handle() const {
+        return curl_m;
+    }
+
     std::string url_escape(const std::string& src) const {
         curl_string_t curl_out{curl_easy_escape(curl_m, src.c_str(), src.size())};
 
@@ -215,6 +287,150 @@ private:
     std::size_t payload_offset_m{0};
     std::string post_data_m;
     std::size_t response_code_m{0};
+    std::size_t connects_m{0};
+    bool        performed_m{false};
+};
+
+/******************************************************************************/
+
+struct curl_pool_stats_t {
+    std::size_t hits_m{0};     // acquisitions served by an idle handle
+    std::size_t misses_m{0};   // acquisitions that had to create a new handle
+    std::size_t reused_m{0};   // transfers that went out over a warm connection
+    std::size_t connects_m{0}; // transfers that had to open a new connection
+    std::size_t idle_m{0};     // handles currently sitting in the pool
+};
+
+/******************************************************************************/
+// A shared pool of warm curl handles. Each handle keeps its own connection
+// cache, so returning it to the pool keeps its connections alive for the next
+// request. The lock is only held long enough to push or pop a handle.
+
+struct curl_pool_t {
+    typedef std::function<void (curl_t&)> init_proc_t;
+    typedef std::mutex                    mutex_t;
+    typedef std::unique_lock<mutex_t>     lock_t;
+
+    struct release_t {
+        void operator()(curl_t* curl) const {
+            pool_m->release(curl);
+        }
+
+        curl_pool_t* pool_m;
+    };
+
+    typedef std::unique_ptr<curl_t, release_t> handle_t;
+
+    // init is called once on every newly created handle (e.g., to set up
+    // headers common to all requests.)
+    explicit curl_pool_t(init_proc_t init = init_proc_t()) :
+        init_m(std::move(init)) {
+    }
+
+    handle_t acquire() {
+        std::unique_ptr<curl_t> result;
+
+        /* pool lock scope */ {
+            lock_t lock{mutex_m};
+
+            if (!idle_m.empty()) {
+                result = std::move(idle_m.back());
+
+                idle_m.pop_back();
+            }
+        }
+
+        if (result) {
+            ++hits_m;
+        } else {
+            ++misses_m;
+
+            result.reset(new curl_t);
+
+            if (init_m) {
+                init_m(*result);
+            }
+        }
+
+        return handle_t{result.release(), release_t{this}};
+    }
+
+    // Calls proc on each handle that was idle when refresh was called, coldest
+    // first. Handles are taken out one at a time (and go back to the hot end
+    // of the pool) so concurrent acquire()s aren't starved. Good for keeping
+    // idle connections from timing out.
+    template <typename F>
+    void refresh(F proc) {
+        std::size_t count{0};
+
+        /* pool lock scope */ {
+            lock_t lock{mutex_m};
+
+            count = idle_m.size();
+        }
+
+        while (count--) {
+            std::unique_ptr<curl_t> curl;
+
+            /* pool lock scope */ {
+                lock_t lock{mutex_m};
+
+                if (idle_m.empty())
+                    return;
+
+                curl = std::move(idle_m.front());
+
+                idle_m.erase(idle_m.begin());
+            }
+
+            handle_t handle{curl.release(), release_t{this}};
+
+            proc(*handle);
+        }
+    }
+
+    curl_pool_stats_t stats() const {
+        curl_pool_stats_t result;
+
+        result.hits_m = hits_m;
+        result.misses_m = misses_m;
+        result.reused_m = reused_m;
+        result.connects_m = connects_m;
+
+        lock_t lock{mutex_m};
+
+        result.idle_m = idle_m.size();
+
+        return result;
+    }
+
+private:
+    curl_pool_t(const curl_pool_t&) = delete;
+    curl_pool_t(curl_pool_t&&) = delete;
+    curl_pool_t& operator=(const curl_pool_t&) = delete;
+    curl_pool_t& operator=(curl_pool_t&&) = delete;
+
+    void release(curl_t* raw) {
+        std::unique_ptr<curl_t> curl(raw);
+
+        if (curl->performed()) {
+            ++(curl->connects() ? connects_m : reused_m);
+        }
+
+        curl->reset();
+
+        lock_t lock{mutex_m};
+
+        idle_m.push_back(std::move(curl));
+    }
+
+    init_proc_t                          init_m;
+    std::vector<std::unique_ptr<curl_t>> idle_m;
+    mutable mutex_t                      mutex_m;
+    std::atomic<std::size_t>             hits_m{0};
+    std::atomic<std::size_t>             misses_m{0};
+    std::atomic<std::size_t>             reused_m{0};
+    std::atomic<std::size_t>             connects_m{0};
 };
 
 /******************************************************************************/
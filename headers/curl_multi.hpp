@@ -0,0 +1,69 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef curl_multi_hpp__
+#define curl_multi_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+
+// application
+#include "curl.hpp"
+
+/******************************************************************************/
+// Nonblocking transfers on top of libcurl's multi_ interface. Socket readiness
+// and curl's timeouts are driven by the shared boost::asio io_service (see
+// service.hpp), so any number of transfers can be in flight from the single
+// io thread.
+
+struct curl_multi_t {
+    // Called on the io thread once the transfer is complete. error is null
+    // iff curl_t::finish succeeded; the handle goes back to its pool when the
+    // completion returns, so copy anything you need out of it.
+    typedef std::function<void (curl_t&, std::exception_ptr)> completion_t;
+
+    curl_multi_t();
+
+    // Threadsafe. The handle should be set up (url, post data, etc.) as it
+    // would be for curl_t::perform.
+    void perform(curl_pool_t::handle_t curl, completion_t completion);
+
+    // As above, but the transfer won't start until delay has passed. Nothing
+    // else is held up in the meantime.
+    void perform_after(std::chrono::steady_clock::duration delay,
+                       curl_pool_t::handle_t               curl,
+                       completion_t                        completion);
+
+    // The number of transfers submitted but not yet completed.
+    std::size_t in_flight() const;
+
+    // When enabled, concurrent HTTP/2 transfers to the same host share one
+    // connection as separate streams. Handles must also be set up with
+    // curl_t::set_http2 for it to have any effect.
+    void set_multiplexing(bool multiplex);
+
+private:
+    curl_multi_t(const curl_multi_t&) = delete;
+    curl_multi_t(curl_multi_t&&) = delete;
+    curl_multi_t& operator=(const curl_multi_t&) = delete;
+    curl_multi_t& operator=(curl_multi_t&&) = delete;
+
+    struct impl_t;
+
+    std::shared_ptr<impl_t> impl_m;
+};
+
+/******************************************************************************/
+
+#endif // curl_multi_hpp__
+
+/******************************************************************************/
@@ -0,0 +1,70 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef decode_hpp__
+#define decode_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <string>
+
+// application
+#include "stock.hpp"
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+// Specialized decoders for the frames the websockets send all day long. They
+// index the raw payload (see json_index_t) and pull out just the fields they
+// need, writing straight into the result with no json_t in between; names
+// are interned (see symbol.hpp) and fills reuse the result's capacity, so a
+// result that is decoded into over and over stops allocating.
+//
+// They only take the happy path. Anything they don't expect - a frame that
+// isn't "ok", a missing object, escapes, fractional or negative numbers,
+// malformed text - makes them return false, leaving the result unspecified.
+// Fall back to parse_json (and error_check) then.
+
+/******************************************************************************/
+
+// A tickertape frame: {"ok":true,"quote":{...}}. Fields the quote leaves out
+// (e.g., "bid" when there are no bids) come out zero or empty, as they do
+// from make_ticker.
+bool decode_tick(const char* first, const char* last, ticker_t& ticker);
+
+inline bool decode_tick(const std::string& payload, ticker_t& ticker) {
+    return decode_tick(payload.data(), payload.data() + payload.size(), ticker);
+}
+
+// The parse_json route for the same frame.
+ticker_t make_ticker(const json_t& json);
+
+// An executions frame: {"ok":true,"order":{...},...}. The key is the order's
+// (venue, id), as make_order has it.
+bool decode_execution(const char*  first,
+                      const char*  last,
+                      order_key_t& key,
+                      execution_t& execution);
+
+inline bool decode_execution(const std::string& payload,
+                             order_key_t&       key,
+                             execution_t&       execution) {
+    return decode_execution(payload.data(), payload.data() + payload.size(), key, execution);
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
+
+#endif // decode_hpp__
+
+/******************************************************************************/
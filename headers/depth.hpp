@@ -0,0 +1,100 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef depth_hpp__
+#define depth_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <vector>
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+
+struct level_t {
+    std::size_t price_m{0};
+    std::size_t quantity_m{0};
+};
+
+typedef std::vector<level_t> levels_t;
+
+/******************************************************************************/
+// The full depth of one symbol's order book. Each side keeps its levels in
+// price order, and the window_k prices around its touch also as an array of
+// resting quantity indexed by price, so quantity and cumulative-depth queries
+// near the touch are walks over contiguous memory. The window moves with the
+// touch; levels out beyond it (a stray 1 cent bid, say) are only in the list.
+// Snapshots from the venue are diffed against the current state and only the
+// levels that changed are written, unless the touch has moved far enough for
+// the window to recentre, which rebuilds it.
+
+struct depth_book_t {
+    // Replaces both sides with a snapshot from the venue. Entries may come in
+    // any order and may repeat a price (they are summed.) Returns the number
+    // of price levels that changed.
+    std::size_t apply(const levels_t& bids, const levels_t& asks);
+
+    std::size_t best_bid() const; // zero if there are no bids
+    std::size_t best_ask() const; // zero if there are no asks
+
+    // Quantity resting at exactly this price.
+    std::size_t bid_quantity(std::size_t price) const;
+    std::size_t ask_quantity(std::size_t price) const;
+
+    // Quantity resting at this price or better (bids at or above it; asks at
+    // or below it), i.e., how much a marketable order limited at this price
+    // could take out.
+    std::size_t cumulative_bid(std::size_t price) const;
+    std::size_t cumulative_ask(std::size_t price) const;
+
+    std::size_t bid_depth() const; // aggregate size of all bids
+    std::size_t ask_depth() const; // aggregate size of all asks
+
+    // Up to count levels from the best price outward.
+    levels_t top_bids(std::size_t count) const;
+    levels_t top_asks(std::size_t count) const;
+
+private:
+    struct side_t {
+        // descending: the touch is the highest price (bids), not the lowest
+        std::size_t apply(const levels_t& levels, bool descending, levels_t& scratch);
+
+        std::size_t quantity(std::size_t price) const;
+        std::size_t cumulative(std::size_t first, std::size_t last) const; // inclusive
+        levels_t    walk(std::size_t count, bool descending) const;
+
+        bool in_window(std::size_t price) const;
+        void write_window(const levels_t& levels);
+        std::size_t sum_levels(std::size_t first, std::size_t last) const; // inclusive
+
+        static constexpr std::size_t window_k = 1024; // prices
+
+        std::vector<std::size_t> quantity_m; // by price - base_m; empty or window_k long
+        std::size_t              base_m{0};
+        levels_t                 levels_m; // those with quantity, ascending by price
+        std::size_t              total_m{0};
+    };
+
+    side_t   bids_m;
+    side_t   asks_m;
+    levels_t scratch_m;
+};
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
+
+#endif // depth_hpp__
+
+/******************************************************************************/
@@ -27,9 +27,11 @@ struct game_t {
     void start();
 
     std::string       quote();
+    std::string       depth(); // top of the full order book
     stock::holdings_t holdings();
-    void              buy(std::size_t qty, std::size_t price);
-    void              sell(std::size_t qty, std::size_t price);
+    void              buy(std::size_t qty, std::size_t price); // nonblocking
+    void              sell(std::size_t qty, std::size_t price); // nonblocking
+    std::string       cancel_all(); // blocks until every open order is pulled
     std::size_t       instance_id() const;
 
 private:
@@ -0,0 +1,161 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef histogram_hpp__
+#define histogram_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/******************************************************************************/
+// An HDR-style latency histogram. Values are bucketed log-linearly: each power
+// of two is split into 2^sub_bits_k equal sub-buckets, so every recorded
+// value is accurate to within ~3%. record() is lock- and allocation-free and
+// may be called from any number of threads while others read.
+
+struct latency_histogram_t {
+    typedef std::chrono::nanoseconds duration_t;
+
+    static constexpr std::size_t sub_bits_k = 5;
+    static constexpr std::size_t sub_count_k = std::size_t(1) << sub_bits_k;
+    static constexpr std::size_t bucket_count_k = (64 - sub_bits_k + 1) * sub_count_k;
+
+    struct summary_t {
+        std::uint64_t count_m{0};
+        std::uint64_t p50_m{0};  // all in nanoseconds
+        std::uint64_t p99_m{0};
+        std::uint64_t p999_m{0};
+        std::uint64_t max_m{0};
+        std::uint64_t mean_m{0};
+    };
+
+    latency_histogram_t() {
+        for (auto& count : counts_m) {
+            count = 0;
+        }
+    }
+
+    void record(duration_t duration) {
+        record(static_cast<std::uint64_t>(std::max<duration_t::rep>(duration.count(), 0)));
+    }
+
+    void record(std::uint64_t ns) {
+        counts_m[index(ns)].fetch_add(1, std::memory_order_relaxed);
+        total_m.fetch_add(1, std::memory_order_relaxed);
+        sum_m.fetch_add(ns, std::memory_order_relaxed);
+
+        std::uint64_t max = max_m.load(std::memory_order_relaxed);
+
+        while (ns > max && !max_m.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    // The smallest recorded value v such that a fraction q of all recorded
+    // values are <= v (to within bucket precision.)
+    std::uint64_t percentile(double q) const {
+        std::uint64_t total = total_m.load(std::memory_order_relaxed);
+
+        if (!total)
+            return 0;
+
+        std::uint64_t target = static_cast<std::uint64_t>(q * total + 0.5);
+        std::uint64_t seen{0};
+
+        if (target < 1) {
+            target = 1;
+        }
+
+        for (std::size_t i(0); i < bucket_count_k; ++i) {
+            seen += counts_m[i].load(std::memory_order_relaxed);
+
+            if (seen >= target) {
+                return std::min(highest_value(i), max_m.load(std::memory_order_relaxed));
+            }
+        }
+
+        return max_m;
+    }
+
+    summary_t summary() const {
+        summary_t result;
+
+        result.count_m = total_m;
+        result.p50_m = percentile(0.5);
+        result.p99_m = percentile(0.99);
+        result.p999_m = percentile(0.999);
+        result.max_m = max_m;
+        result.mean_m = result.count_m ? sum_m / result.count_m : 0;
+
+        return result;
+    }
+
+private:
+    latency_histogram_t(const latency_histogram_t&) = delete;
+    latency_histogram_t(latency_histogram_t&&) = delete;
+    latency_histogram_t& operator=(const latency_histogram_t&) = delete;
+    latency_histogram_t& operator=(latency_histogram_t&&) = delete;
+
+    static std::size_t index(std::uint64_t ns) {
+        if (ns < sub_count_k)
+            return ns;
+
+        std::size_t magnitude = 63 - __builtin_clzll(ns);
+        std::size_t shift = magnitude - sub_bits_k;
+        std::size_t sub = (ns >> shift) - sub_count_k;
+
+        return (shift + 1) * sub_count_k + sub;
+    }
+
+    static std::uint64_t highest_value(std::size_t index) {
+        std::size_t group = index / sub_count_k;
+        std::size_t sub = index % sub_count_k;
+
+        if (!group)
+            return sub;
+
+        std::size_t shift = group - 1;
+
+        return (((sub + sub_count_k) << shift) + (std::uint64_t(1) << shift)) - 1;
+    }
+
+    std::array<std::atomic<std::uint64_t>, bucket_count_k> counts_m;
+    std::atomic<std::uint64_t>                             total_m{0};
+    std::atomic<std::uint64_t>                             sum_m{0};
+    std::atomic<std::uint64_t>                             max_m{0};
+};
+
+/******************************************************************************/
+// Records the lifetime of the timer into a histogram.
+
+struct latency_timer_t {
+    typedef std::chrono::steady_clock clock_t;
+
+    explicit latency_timer_t(latency_histogram_t& histogram) :
+        histogram_m(histogram),
+        start_m(clock_t::now()) {
+    }
+
+    ~latency_timer_t() {
+        histogram_m.record(clock_t::now() - start_m);
+    }
+
+private:
+    latency_histogram_t& histogram_m;
+    clock_t::time_point  start_m;
+};
+
+/******************************************************************************/
+
+#endif // histogram_hpp__
+
+/******************************************************************************/
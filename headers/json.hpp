@@ -10,6 +10,11 @@
 
 /******************************************************************************/
 
+// stdc++
+#include <cstdint>
+#include <string>
+#include <vector>
+
 // application
 #include "json_fwd.hpp"
 
@@ -17,6 +22,172 @@
 
 json_t parse_json(const std::string& json_raw);
 
+/******************************************************************************/
+// A structural index of a raw json payload: the offsets of every '{', '}',
+// '[', ']', ':' and ',' outside of a string, and of the (unescaped) quotes
+// that open and close every string. The payload is classified 32 bytes at a
+// time by an AVX2, SSE4.2 or plain scalar kernel, whichever the cpu supports
+// (picked once, at first use.)
+//
+// The index doesn't validate the payload beyond balancing its quotes and
+// brackets; what it does is let a json_view_t step over whole values without
+// looking at their bytes. Reuse one to keep its storage.
+
+struct json_view_t;
+
+struct json_index_t {
+    // Indexes [first, last), which must outlive the index. Returns false if a
+    // string is left open or the brackets don't pair up.
+    bool build(const char* first, const char* last);
+
+    // The payload as a single object or array (with nothing after it), or an
+    // invalid view if it isn't one.
+    json_view_t root() const;
+
+    // "AVX2", "SSE4.2" or "SCALAR"
+    static const char* kernel();
+
+private:
+    friend struct json_view_t;
+
+    bool match();
+
+    const char*                first_m{nullptr};
+    const char*                last_m{nullptr};
+    std::vector<std::uint32_t> positions_m; // the first count_m are in use
+    std::vector<std::uint32_t> closes_m;    // for each '{' or '[', where it closes
+    std::vector<std::uint32_t> opens_m;     // match()'s stack
+    std::size_t                count_m{0};
+    bool                       built_m{false};
+};
+
+/******************************************************************************/
+// On-demand access to one value of an indexed payload: nothing is decoded
+// until it is asked for, and members that aren't asked for are stepped over
+// by the index. Lookups and conversions on a missing value, or on a value of
+// the wrong shape, fail (invalid view, or false) rather than throw.
+
+struct json_view_t {
+    bool valid() const { return index_m != nullptr; }
+    bool is_object() const { return valid() && *first_m == '{'; }
+    bool is_array() const { return valid() && *first_m == '['; }
+
+    // The member with this key, if this is an object that has one.
+    json_view_t operator[](const char* key) const;
+
+    // Calls f(element) for each element of an array, stopping early (and
+    // returning false) if f returns false.
+    template <typename F>
+    bool for_each(F f) const;
+
+    // Calls f(key, size, value) for each member of an object, in order, with
+    // the same early out. One pass, where a lookup per field would start over
+    // from the top each time.
+    template <typename F>
+    bool for_each_member(F f) const;
+
+    // Non-negative integers that fit an int; no fractions or exponents.
+    bool get(std::size_t& value) const;
+    bool get(bool& value) const;
+
+    // The raw text of a string (without the quotes), which must have no
+    // escapes in it.
+    bool get(const char*& first, std::size_t& size) const;
+
+    // Same, assigned into value (reusing its capacity.)
+    bool get(std::string& value) const;
+
+private:
+    friend struct json_index_t;
+
+    json_view_t() = default;
+    json_view_t(const json_index_t& index, const char* first, std::size_t next);
+
+    // Where a value that starts after a structural begins, and the index of
+    // the first structural at or after that.
+    json_view_t after(std::size_t structural) const;
+
+    // The index of the first structural past this value, or npos.
+    std::size_t skip() const;
+
+    // The key of the member whose opening quote is at this structural.
+    bool key(std::size_t structural, const char*& first, std::size_t& size) const;
+
+    char at(std::size_t structural) const;
+
+    const json_index_t* index_m{nullptr};
+    const char*         first_m{nullptr}; // first byte of the value
+    std::size_t         next_m{0};        // first structural at or after first_m
+};
+
+/******************************************************************************/
+
+template <typename F>
+bool json_view_t::for_each(F f) const {
+    if (!is_array())
+        return false;
+
+    for (std::size_t i(next_m);;) {
+        json_view_t element = after(i);
+
+        if (!element.valid())
+            return false;
+
+        // (Scalars aren't in the index, so look for an empty array here.)
+        if (i == next_m && *element.first_m == ']')
+            return true;
+
+        if (!f(element))
+            return false;
+
+        i = element.skip();
+
+        char c = at(i);
+
+        if (c == ']')
+            return true;
+
+        if (c != ',')
+            return false;
+    }
+}
+
+/******************************************************************************/
+
+template <typename F>
+bool json_view_t::for_each_member(F f) const {
+    if (!is_object())
+        return false;
+
+    if (at(next_m + 1) == '}')
+        return true;
+
+    for (std::size_t i(next_m + 1);;) {
+        const char* first;
+        std::size_t size;
+
+        if (!key(i, first, size))
+            return false;
+
+        json_view_t value = after(i + 2);
+
+        if (!value.valid() || !f(first, size, value))
+            return false;
+
+        i = value.skip();
+
+        char c = at(i);
+
+        if (c == '}')
+            return true;
+
+        if (c != ',')
+            return false;
+
+        ++i;
+    }
+}
+
 /******************************************************************************/
 
 #endif // json_hpp__
@@ -0,0 +1,160 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef matching_hpp__
+#define matching_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// application
+#include "depth.hpp"
+#include "stock.hpp"
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+// A single-symbol, price-time priority matching engine with the venue's order
+// semantics (limit, market, fill-or-kill and immediate-or-cancel.) Standing
+// orders always trade at their own price. This is the exchange side of the
+// orders the engine_t sends; it is what the mock exchange and the simulator
+// run against.
+//
+// Every call is threadsafe. Execution handlers are called after the book lock
+// is released, in the order the fills happened, once per side of each fill.
+
+struct matching_engine_t {
+    // id is the id of the execution's order_m.
+    typedef std::function<void (std::size_t id, const execution_t&)> execution_handler_t;
+
+    matching_engine_t(const std::string& venue, const std::string& symbol);
+
+    // Called twice per fill: once with the standing order's account and order
+    // and once with the incoming order's.
+    void handle_execution(execution_handler_t handler);
+
+    // Background order flow (bots): this account's orders get no execution
+    // reports and are forgotten as soon as they close, so a long run doesn't
+    // keep every one of them around for status queries that won't come.
+    void add_background_account(symbol_id_t account);
+
+    // Matches a new order against the book and rests any limit remainder.
+    // Returns the order id and its state after matching. ts is the venue
+    // timestamp stamped onto the order, its fills and the quote.
+    order_book_t::value_type submit(symbol_id_t  account,
+                                    direction_t  direction,
+                                    order_type_t type,
+                                    std::size_t  price,
+                                    std::size_t  quantity,
+                                    timestamp_t  ts);
+
+    // Closes the order if it is still open. Throws if the id is unknown (or
+    // was a closed background order.)
+    order_book_t::value_type cancel(std::size_t id, timestamp_t ts);
+
+    // Throws if the id is unknown.
+    order_book_t::value_type status(std::size_t id) const;
+
+    bool open(std::size_t id) const; // false once closed (or forgotten)
+
+    // Every order the account has ever sent here, by id.
+    std::vector<order_book_t::value_type> orders(symbol_id_t account) const;
+
+    ticker_t quote() const;
+
+    // Aggregate resting quantity per price; bids best (highest) first, asks
+    // best (lowest) first.
+    void levels(levels_t& bids, levels_t& asks) const;
+
+    std::size_t order_count() const; // ever submitted
+
+    const std::string& venue() const { return symbol_name(venue_m); }
+    const std::string& symbol() const { return symbol_name(symbol_m); }
+    symbol_id_t        venue_id() const { return venue_m; }
+
+private:
+    struct entry_t {
+        order_t order_m;
+        bool    background_m{false};
+    };
+
+    struct price_level_t {
+        std::deque<std::size_t> queue_m; // order ids in time priority
+        std::size_t             quantity_m{0}; // open quantity resting here
+    };
+
+    typedef std::map<std::size_t, price_level_t, std::greater<std::size_t>> bids_t;
+    typedef std::map<std::size_t, price_level_t>                            asks_t;
+    typedef std::vector<std::pair<std::size_t, execution_t>>                executions_t;
+    typedef std::map<std::size_t, entry_t>                                  orders_t;
+
+    template <typename Side>
+    std::size_t available(const Side& side, std::size_t price, bool priced) const;
+
+    // Aggregate open quantity on a side, kept as orders rest, trade and cancel.
+    std::size_t& depth(bids_t&) { return bid_depth_m; }
+    std::size_t& depth(asks_t&) { return ask_depth_m; }
+
+    template <typename Side>
+    void match(Side&              side,
+               entry_t&           incoming,
+               std::size_t        incoming_id,
+               bool               priced,
+               timestamp_t        ts,
+               executions_t&      executions);
+
+    void report(const entry_t&     entry,
+                std::size_t        id,
+                const execution_t& execution,
+                executions_t&      executions) const;
+
+    template <typename Side>
+    void rest(Side& side, std::size_t id, const order_t& order);
+
+    template <typename Side>
+    void unrest(Side& side, std::size_t id, const order_t& order);
+
+    void update_quote(timestamp_t ts);
+
+    const entry_t& entry(std::size_t id) const; // throws if unknown
+
+    order_book_t::value_type value(std::size_t id, const order_t& order) const;
+
+    void notify(const executions_t& executions);
+
+    symbol_id_t           venue_m;
+    symbol_id_t           symbol_m;
+    execution_handler_t   execution_handler_m;
+    std::set<symbol_id_t> background_m; // accounts
+    orders_t              orders_m; // open orders, and the closed ones we keep
+    std::size_t           next_id_m{0};
+    bids_t                bids_m;
+    asks_t                asks_m;
+    std::size_t           bid_depth_m{0};
+    std::size_t           ask_depth_m{0};
+    ticker_t              quote_m;
+    mutable mutex_t       mutex_m;
+};
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
+
+#endif // matching_hpp__
+
+/******************************************************************************/
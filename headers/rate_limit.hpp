@@ -0,0 +1,139 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef rate_limit_hpp__
+#define rate_limit_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+/******************************************************************************/
+// An adaptive token bucket. Tokens refill continuously at rate() per second up
+// to the burst size. When the far end complains (penalize) the rate is halved
+// and all callers are held off for a backoff that doubles with each
+// consecutive complaint; each success (reward) grows the rate back toward its
+// ceiling and clears the backoff.
+//
+// Callers reserve a token and are told how long to wait for it, so a blocked
+// caller never holds the lock and nonblocking callers can schedule the wait
+// however they like.
+
+struct token_bucket_t {
+    typedef std::chrono::steady_clock clock_t;
+    typedef clock_t::duration         duration_t;
+    typedef std::mutex                mutex_t;
+    typedef std::unique_lock<mutex_t> lock_t;
+
+    token_bucket_t(double rate, double burst) :
+        ceiling_m(rate),
+        floor_m(std::max(rate / 64, 1.)),
+        rate_m(rate),
+        burst_m(burst),
+        tokens_m(burst),
+        last_m(clock_t::now()) {
+    }
+
+    // Takes a token, returning how long the caller must wait before using it
+    // (zero means go now.) Tokens can go negative, which queues callers up in
+    // the order they asked.
+    duration_t reserve() {
+        lock_t              lock{mutex_m};
+        clock_t::time_point now(clock_t::now());
+
+        refill_unsafe(now);
+
+        tokens_m -= 1;
+
+        duration_t wait = duration_t::zero();
+
+        if (tokens_m < 0) {
+            wait = std::chrono::duration_cast<duration_t>(std::chrono::duration<double>(-tokens_m / rate_m));
+        }
+
+        if (backoff_until_m > now) {
+            wait = std::max(wait, duration_t(backoff_until_m - now));
+        }
+
+        return wait;
+    }
+
+    // retry_after, if given by the far end, overrides our own backoff when it
+    // is longer.
+    void penalize(duration_t retry_after = duration_t::zero()) {
+        lock_t              lock{mutex_m};
+        clock_t::time_point now(clock_t::now());
+
+        refill_unsafe(now);
+
+        rate_m = std::max(rate_m / 2, floor_m);
+
+        backoff_m = backoff_m == duration_t::zero() ?
+                        std::chrono::duration_cast<duration_t>(std::chrono::milliseconds(50)) :
+                        std::min(backoff_m * 2,
+                                 std::chrono::duration_cast<duration_t>(std::chrono::seconds(5)));
+
+        backoff_until_m = std::max(backoff_until_m,
+                                   now + std::max(backoff_m, retry_after));
+
+        ++penalties_m;
+    }
+
+    void reward() {
+        lock_t lock{mutex_m};
+
+        // additive increase: about 1/16th of the ceiling per success.
+        rate_m = std::min(rate_m + ceiling_m / 16, ceiling_m);
+
+        backoff_m = duration_t::zero();
+    }
+
+    double rate() const {
+        lock_t lock{mutex_m};
+
+        return rate_m;
+    }
+
+    std::size_t penalties() const {
+        return penalties_m;
+    }
+
+private:
+    token_bucket_t(const token_bucket_t&) = delete;
+    token_bucket_t(token_bucket_t&&) = delete;
+    token_bucket_t& operator=(const token_bucket_t&) = delete;
+    token_bucket_t& operator=(token_bucket_t&&) = delete;
+
+    void refill_unsafe(clock_t::time_point now) {
+        std::chrono::duration<double> elapsed = now - last_m;
+
+        tokens_m = std::min(tokens_m + elapsed.count() * rate_m, burst_m);
+
+        last_m = now;
+    }
+
+    const double             ceiling_m; // tokens per second, when all is well
+    const double             floor_m;   // never throttle below this
+    double                   rate_m;
+    const double             burst_m;
+    double                   tokens_m;
+    clock_t::time_point      last_m;
+    duration_t               backoff_m{duration_t::zero()};
+    clock_t::time_point      backoff_until_m;
+    mutable mutex_t          mutex_m;
+    std::atomic<std::size_t> penalties_m{0};
+};
+
+/******************************************************************************/
+
+#endif // rate_limit_hpp__
+
+/******************************************************************************/
@@ -17,6 +17,7 @@
 #include <chrono>
 #include <iostream>
 #include <map>
+#include <memory>
 
 // application
 #include "task_queue.hpp"
@@ -28,7 +29,7 @@ namespace recur {
 /******************************************************************************/
 
 typedef std::chrono::high_resolution_clock clock_t;
-typedef std::function<void ()>             function_t;
+typedef unique_function<void ()>           function_t;
 
 struct token_t {
     explicit token_t(std::size_t id = 0) : id_m{id} { }
@@ -48,12 +49,17 @@ struct job_t {
     token_t           token_m;
     clock_t::duration interval_m;
     function_t        function_m;
+    priority_t        priority_m; // of each run on the task queue
 };
 
+// Jobs are kept by pointer, so handing one to the task queue (and back) moves
+// only the pointer, and the task carrying it fits inline.
+
 struct engine_t {
-    typedef std::mutex                           mutex_t;   
-    typedef std::unique_lock<mutex_t>            lock_t;
-    typedef std::map<clock_t::time_point, job_t> job_map_t;
+    typedef std::mutex                               mutex_t;
+    typedef std::unique_lock<mutex_t>                lock_t;
+    typedef std::unique_ptr<job_t>                   job_ptr_t;
+    typedef std::map<clock_t::time_point, job_ptr_t> job_map_t;
 
     engine_t(task_queue_t& queue) : queue_m(queue) {
     }
@@ -65,10 +71,12 @@ struct engine_t {
     }
 
     template <typename F>
-    token_t insert(clock_t::duration interval, F&& function) {
-        lock_t  lock{mutex_m};
-        job_t   job{token_t{++id_m}, interval, std::forward<F>(function)};
-        token_t result{job.token_m};
+    token_t insert(clock_t::duration interval,
+                   F&&               function,
+                   priority_t        priority = priority_t::normal) {
+        lock_t    lock{mutex_m};
+        job_ptr_t job(new job_t{token_t{++id_m}, interval, std::forward<F>(function), priority});
+        token_t   result{job->token_m};
 
         schedule_unsafe(std::move(job));
 
@@ -81,7 +89,7 @@ struct engine_t {
         lock_t lock{mutex_m};
 
         for (auto iter(begin(jobs_m)), last(end(jobs_m)); iter != last; ++iter) {
-            if (iter->second.token_m != token)
+            if (iter->second->token_m != token)
                 continue;
 
             do_job(iter, lock);
@@ -96,7 +104,7 @@ struct engine_t {
         lock_t lock{mutex_m};
 
         for (auto iter(begin(jobs_m)), last(end(jobs_m)); iter != last; ++iter) {
-            if (iter->second.token_m != token)
+            if (iter->second->token_m != token)
                 continue;
 
             jobs_m.erase(iter);
@@ -178,9 +186,9 @@ private:
         condition_m.notify_one();
     }
 
-    void inner_do_job(job_t job) {
+    void inner_do_job(job_ptr_t& job) {
         try {
-            job.function_m();
+            job->function_m();
         } catch (const std::exception& error) {
             std::cerr << "Job error: " << error.what() << '\n';
         } catch (...) {
@@ -195,15 +203,16 @@ private:
     }
 
     void do_job(job_map_t::iterator job_iter, lock_t& lock) {
-        job_t job(unschedule_unsafe(job_iter));
+        job_ptr_t  job(unschedule_unsafe(job_iter));
+        priority_t priority = job->priority_m;
 
         lock.unlock();
 
-        queue_m.push(std::bind(&engine_t::inner_do_job, std::ref(*this), std::move(job)));
+        queue_m.push(std::bind(&engine_t::inner_do_job, this, std::move(job)), priority);
     }
 
-    void schedule_unsafe(job_t&& job) {
-        clock_t::time_point next{clock_t::now() + job.interval_m};
+    void schedule_unsafe(job_ptr_t&& job) {
+        clock_t::time_point next{clock_t::now() + job->interval_m};
 
         while (jobs_m.count(next))
             next += std::chrono::milliseconds(1);
@@ -211,8 +220,8 @@ private:
         jobs_m.emplace(next, std::move(job));
     }
 
-    job_t unschedule_unsafe(job_map_t::iterator job_iter) {
-        job_t result(std::move(job_iter->second));
+    job_ptr_t unschedule_unsafe(job_map_t::iterator job_iter) {
+        job_ptr_t result(std::move(job_iter->second));
 
         jobs_m.erase(job_iter);
 
@@ -0,0 +1,99 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef seqlock_hpp__
+#define seqlock_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/******************************************************************************/
+// A value published by one writer (at a time) to any number of readers. The
+// writer never waits; readers never block it or each other, and copy the
+// value out onto their own stack, retrying only if a store landed in the
+// middle of the copy.
+//
+// The value is kept as an array of atomic words (loaded and stored relaxed,
+// ordered by fences around the sequence count) so a torn read is a retry, not
+// a data race. T must be trivially copyable. The whole thing is padded out
+// to its own cache lines, so spinning readers don't share one with whatever
+// sits next to it.
+//
+// Writers must be serialized by the caller.
+
+template <typename T>
+struct seqlock_t {
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock_t needs a trivially copyable T");
+
+    seqlock_t() {
+        store(T());
+    }
+
+    void store(const T& value) {
+        word_t words[word_count_k] = { 0 };
+
+        std::memcpy(words, &value, sizeof(T));
+
+        std::uint64_t sequence = sequence_m.load(std::memory_order_relaxed);
+
+        sequence_m.store(sequence + 1, std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i(0); i < word_count_k; ++i) {
+            words_m[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        sequence_m.store(sequence + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        word_t        words[word_count_k];
+        std::uint64_t before;
+        std::uint64_t after;
+
+        do {
+            before = sequence_m.load(std::memory_order_acquire);
+
+            for (std::size_t i(0); i < word_count_k; ++i) {
+                words[i] = words_m[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            after = sequence_m.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        T result;
+
+        std::memcpy(&result, words, sizeof(T));
+
+        return result;
+    }
+
+private:
+    typedef std::uint64_t word_t;
+
+    static constexpr std::size_t cache_line_k = 64;
+    static constexpr std::size_t word_count_k = (sizeof(T) + sizeof(word_t) - 1) / sizeof(word_t);
+
+    char                       before_m[cache_line_k];
+    std::atomic<std::uint64_t> sequence_m{0}; // odd while a store is underway
+    std::atomic<word_t>        words_m[word_count_k];
+    char                       after_m[cache_line_k];
+};
+
+/******************************************************************************/
+
+#endif // seqlock_hpp__
+
+/******************************************************************************/
@@ -0,0 +1,41 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef service_hpp__
+#define service_hpp__
+
+/******************************************************************************/
+
+// boost
+#include <boost/asio/io_service.hpp>
+
+/******************************************************************************/
+
+namespace service {
+
+/******************************************************************************/
+
+// The io_service shared by the websockets and the nonblocking curl engine.
+boost::asio::io_service& io();
+
+/******************************************************************************/
+
+// Spins up (once) a dedicated thread that runs io() until shutdown, so
+// completions are delivered as soon as they happen. It's the only thread that
+// ever runs io(): handlers on it need no lock against each other. Safe to
+// call repeatedly.
+void start();
+
+/******************************************************************************/
+
+} // namespace service
+
+/******************************************************************************/
+
+#endif // service_hpp__
+
+/******************************************************************************/
@@ -0,0 +1,129 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef sim_hpp__
+#define sim_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+// application
+#include "matching.hpp"
+#include "stock.hpp"
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+// An in-process exchange for backtests. Plugged into an engine_t (see
+// engine_t::simulate) it stands in for the venue: orders and cancels are
+// direct calls into a matching engine, and ticks and executions come back as
+// direct calls too - no sockets, no json, no threads.
+//
+// Background order flow comes from a seeded generator and time is simulated,
+// so a given seed produces the same ticks, fills and timestamps on every run
+// (as long as the strategy reacting to them is itself deterministic.)
+//
+// Threadsafe: every call is serialized, and run() takes the lock an event at
+// a time, so an order from another thread (the console, say) lands between
+// two events. The handlers are called with the lock held, and may trade from
+// within. Trading from other threads makes the run depend on their timing,
+// of course; only the seed and the handlers make it repeatable.
+
+struct sim_exchange_t {
+    typedef std::function<void (const ticker_t&)>                tick_handler_t;
+    typedef std::function<void (order_key_t, const execution_t&)> execution_handler_t;
+
+    explicit sim_exchange_t(std::uint64_t seed,
+                            std::string   venue = "SIMEX",
+                            std::string   symbol = "SIMU",
+                            std::string   account = "SIM00000");
+
+    // Every quote change, and every fill on the trading account's orders.
+    // Both are delivered from within run(), after the event that caused them.
+    void handle_tick(tick_handler_t handler);
+    void handle_execution(execution_handler_t handler);
+
+    // The trading account's side of the venue.
+    order_book_t::value_type              submit(direction_t  direction,
+                                                 order_type_t type,
+                                                 std::size_t  price,
+                                                 std::size_t  quantity);
+    order_book_t::value_type              cancel(std::size_t id);
+    std::vector<order_book_t::value_type> orders() const;
+    void                                  levels(levels_t& bids, levels_t& asks) const;
+
+    // Generates this many background events (orders, cancels, crosses),
+    // delivering the resulting ticks and executions as it goes.
+    void run(std::size_t events);
+
+    std::size_t   events() const; // run so far
+    std::uint64_t now() const; // simulated ns since the open
+
+    const std::string& venue() const { return engine_m.venue(); }
+    const std::string& symbol() const { return engine_m.symbol(); }
+    const std::string& account() const { return account_m; }
+
+private:
+    sim_exchange_t(const sim_exchange_t&) = delete;
+    sim_exchange_t(sim_exchange_t&&) = delete;
+    sim_exchange_t& operator=(const sim_exchange_t&) = delete;
+    sim_exchange_t& operator=(sim_exchange_t&&) = delete;
+
+    typedef std::uniform_int_distribution<std::size_t> uniform_t;
+    typedef std::pair<order_key_t, execution_t>        pending_execution_t;
+    typedef std::recursive_mutex                       mutex_t; // the handlers trade
+    typedef std::lock_guard<mutex_t>                   lock_t;
+
+    timestamp_t stamp() const { return static_cast<timestamp_t>(clock_m); } // as a venue timestamp
+
+    void step(); // one background event
+
+    void cancel_background(timestamp_t ts);
+
+    void deliver(); // ticks and executions owed to the handlers
+
+    mutable mutex_t                  mutex_m;
+    matching_engine_t                engine_m;
+    std::string                      account_m;
+    symbol_id_t                      account_id_m;
+    symbol_id_t                      bot_account_m{intern_symbol("SIMBOT")};
+    std::mt19937_64                  random_m;
+    uniform_t                        gap_m{1000, 100000}; // ns between events
+    uniform_t                        action_m{0, 99};
+    uniform_t                        offset_m{1, 40}; // cents from fair value
+    uniform_t                        size_m{1, 100};
+    std::bernoulli_distribution      coin_m{0.5};
+    std::size_t                      fair_m{5000}; // cents
+    std::deque<std::size_t>          open_m; // background orders resting
+    std::uint64_t                    clock_m{0};
+    std::size_t                      events_m{0};
+    bool                             ticked_m{false}; // quote changed since the last delivery
+    std::vector<pending_execution_t> executions_m;
+    std::vector<pending_execution_t> delivering_m;
+    tick_handler_t                   tick_handler_m;
+    execution_handler_t              execution_handler_m;
+};
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
+
+#endif // sim_hpp__
+
+/******************************************************************************/
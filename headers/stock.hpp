@@ -11,14 +11,25 @@
 /******************************************************************************/
 
 // stdc++
+#include <chrono>
+#include <functional>
+#include <future>
 #include <string>
-#include <map>
 #include <vector>
 #include <mutex>
 
 // application
+#include "depth.hpp"
+#include "histogram.hpp"
 #include "json.hpp"
+#include "seqlock.hpp"
 #include "stock_fwd.hpp"
+#include "symbol.hpp"
+#include "timestamp.hpp"
+
+/******************************************************************************/
+
+struct curl_pool_stats_t;
 
 /******************************************************************************/
 
@@ -29,10 +40,60 @@ namespace stock {
 typedef std::mutex                mutex_t;
 typedef std::unique_lock<mutex_t> lock_t;
 
+struct sim_exchange_t;
+
+/******************************************************************************/
+
+// Base url of the order book api and its websockets, e.g.,
+// https://api.stockfighter.io/ob/api/ (or wherever the settings point it.)
+const std::string& api_url();
+
 /******************************************************************************/
 
 bool heartbeat();
 
+// Sends a heartbeat over every idle pooled connection (and the nonblocking
+// engine's) so none of them go cold between orders.
+void keep_warm();
+
+/******************************************************************************/
+
+// hit/miss and connection reuse counts for the REST connection pool.
+curl_pool_stats_t connection_stats();
+
+/******************************************************************************/
+
+// Classes of REST call, for latency accounting.
+enum class endpoint_t {
+    order,
+    cancel,
+    heartbeat,
+    world,  // world state refresh
+    status, // order status and reconciliation
+    book,   // full order book (depth) polling
+    level   // level start, restart, stop and resume
+};
+
+constexpr std::size_t endpoint_count_k = static_cast<std::size_t>(endpoint_t::level) + 1;
+
+const char* endpoint_name(endpoint_t endpoint);
+
+// Round trip latencies (request sent to response received) seen so far.
+latency_histogram_t::summary_t latency(endpoint_t endpoint);
+
+// One line per endpoint class that has seen traffic.
+std::vector<std::string> latency_report();
+
+// Current client-side rate limit (and backoff count) for orders, cancels and
+// polling. Heartbeats share the polling limit.
+std::vector<std::string> rate_limit_report();
+
+/******************************************************************************/
+
+// The REST transport in use. HTTP/2 when the settings ask for it and libcurl
+// supports it; HTTP/1.1 otherwise.
+const char* transport();
+
 /******************************************************************************/
 
 void error_check(const json_t& json);
@@ -61,8 +122,8 @@ struct ticker_t {
     std::size_t last_m;       // price of last trade
     std::size_t last_size_m;  // quantity of last trade
 
-    std::string last_trade_m; // timestamp of last trade
-    std::string quote_time_m; // server ts of quote generation
+    timestamp_t last_trade_m; // timestamp of last trade
+    timestamp_t quote_time_m; // server ts of quote generation
 };
 
 enum class order_type_t {
@@ -122,18 +183,54 @@ enum class direction_t {
 struct fill_t {
     std::size_t price_m;
     std::size_t quantity_m;
-    std::string ts_m;
+    timestamp_t ts_m;
 };
 
-typedef std::vector<fill_t> fills_t;
+// The fills on an order. Shrinking it (clear) keeps the storage past the end
+// for the next decode into the same order to write over; copies carry only
+// the fills in use.
+struct fills_t {
+    typedef fill_t*       iterator;
+    typedef const fill_t* const_iterator;
+
+    fills_t() = default;
+    fills_t(const fills_t& rhs);
+    fills_t(fills_t&& rhs) noexcept;
+    fills_t& operator=(const fills_t& rhs);
+    fills_t& operator=(fills_t&& rhs) noexcept;
+
+    std::size_t size() const { return size_m; }
+    bool        empty() const { return size_m == 0; }
+
+    iterator       begin() { return storage_m.data(); }
+    iterator       end() { return storage_m.data() + size_m; }
+    const_iterator begin() const { return storage_m.data(); }
+    const_iterator end() const { return storage_m.data() + size_m; }
+
+    fill_t&       operator[](std::size_t i) { return storage_m[i]; }
+    const fill_t& operator[](std::size_t i) const { return storage_m[i]; }
+    fill_t&       back() { return storage_m[size_m - 1]; }
+    const fill_t& back() const { return storage_m[size_m - 1]; }
+
+    // Appends a fill and returns it, reusing a spare one if there is one (in
+    // which case it still holds whatever it held before.)
+    fill_t& next();
+
+    void push_back(const fill_t& fill) { next() = fill; }
+    void clear() { size_m = 0; }
+
+private:
+    std::vector<fill_t> storage_m;
+    std::size_t         size_m{0};
+};
 
 fill_t make_fill(const json_t& json);
 
 struct order_t {
     bool         open_m{false};
     bool         complete_m{false};
-    std::string  account_m;
-    std::string  symbol_m;
+    symbol_id_t  account_m{0};
+    symbol_id_t  symbol_m{0};
     direction_t  direction_m;
     order_type_t type_m;
     fills_t      fills_m; // may have zero or multiple fills
@@ -141,34 +238,166 @@ struct order_t {
     std::size_t  price_m{0}; // the price on the order (which may not match the fills)
     std::size_t  quantity_m{0}; // unfulfilled quantity
     std::size_t  total_filled_m{0}; // fulfilled quantity
-    std::string  timestamp_m; // time when order was received
+    timestamp_t  timestamp_m{0}; // time when order was received
 
     std::size_t cash_value() const; // always positive
 };
 
 // order_key_t is the venue symbol and the originating order id, which is
-// guaranteed to be unique on this venue.
-typedef std::pair<std::string, std::size_t> order_key_t;
-typedef std::map<order_key_t, order_t>      order_book_t;
+// guaranteed to be unique on this venue, packed into one integer: the venue's
+// symbol id in the top 16 bits and the order id in the rest.
+typedef std::uint64_t order_key_t;
+
+const unsigned order_key_shift_k = 48;
+
+inline order_key_t make_order_key(symbol_id_t venue, std::size_t id) {
+    return static_cast<order_key_t>(venue) << order_key_shift_k |
+           (static_cast<order_key_t>(id) & ((order_key_t(1) << order_key_shift_k) - 1));
+}
+
+inline symbol_id_t order_key_venue(order_key_t key) {
+    return static_cast<symbol_id_t>(key >> order_key_shift_k);
+}
+
+inline std::size_t order_key_id(order_key_t key) {
+    return static_cast<std::size_t>(key & ((order_key_t(1) << order_key_shift_k) - 1));
+}
+
+// Every order we've sent, by key. Orders sit in one contiguous arena in the
+// order they were first seen and are never removed; an open-addressing index
+// (linear probing over keys, so a lookup doesn't touch the arena until it
+// hits) maps keys to arena slots, and a dense list of the open ones keeps
+// walking them proportional to how many there are, not to the session.
+//
+// It also keeps the position and cash all the orders add up to, adjusted by
+// each order's change as it is written: a new fill on an order costs that
+// fill, not a recount of the book (or of the order's other fills.)
+//
+// Not threadsafe; engine_t keeps it behind book_mutex_m.
+struct order_book_t {
+    typedef std::pair<order_key_t, order_t> value_type;
+
+    // The order under the key, or null.
+    const order_t* find(order_key_t key) const;
+
+    // Adds the order, or replaces the one already under the key.
+    void assign(order_key_t key, order_t order);
+
+    // Adds the order unless there's already one under the key (which is left
+    // alone.) Returns true iff it was added.
+    bool insert(order_key_t key, order_t order);
+
+    std::size_t size() const { return orders_m.size(); }
+    std::size_t open_count() const { return open_m.size(); }
+
+    // Position and cash over every order; nav_m is left to the caller, who
+    // knows the last price.
+    const holdings_t& holdings() const { return holdings_m; }
+
+    // f(const value_type&) for every order, oldest first.
+    template <typename F>
+    void for_each(F f) const {
+        for (const auto& order : orders_m) {
+            f(order);
+        }
+    }
+
+    // f(const value_type&) for every open order, in no particular order.
+    template <typename F>
+    void for_each_open(F f) const {
+        for (std::uint32_t slot : open_m) {
+            f(orders_m[slot]);
+        }
+    }
+
+private:
+    struct bucket_t {
+        order_key_t   key_m{0};
+        std::uint32_t slot_m{0}; // arena slot + 1; 0 is an empty bucket
+    };
+
+    // What one order has put into holdings_m so far.
+    struct held_t {
+        std::size_t  fills_m{0}; // fills priced into value_m
+        std::size_t  value_m{0}; // cash_value() of those fills
+        std::int64_t cash_m{0};
+        std::int64_t position_m{0};
+    };
+
+    bucket_t&       bucket(order_key_t key); // where the key is, or would go
+    const bucket_t& bucket(order_key_t key) const;
+
+    void grow(); // doubles the index, keeping it at most half full
+
+    void update(std::uint32_t slot); // after the order in the slot changed
+    void update_open(std::uint32_t slot);
+    void update_holdings(std::uint32_t slot);
+
+    std::vector<value_type>    orders_m; // the arena
+    std::vector<std::uint32_t> open_at_m; // by slot: position in open_m + 1, or 0
+    std::vector<std::uint32_t> open_m; // slots of open orders
+    std::vector<bucket_t>      index_m; // size is zero or a power of two
+    std::vector<held_t>        held_m; // by slot
+    holdings_t                 holdings_m;
+};
 
 order_book_t::value_type make_order(const json_t& json);
 
 struct execution_t {
     order_t     order_m;
-    std::string account_m;
-    std::string venue_m;
-    std::string symbol_m;
+    symbol_id_t account_m{0};
+    symbol_id_t venue_m{0};
+    symbol_id_t symbol_m{0};
     std::size_t standing_id_m{0};
     std::size_t incoming_id_m{0};
     std::size_t price_m{0};
     std::size_t filled_m{0};
-    std::string filled_at_m{0};
+    timestamp_t filled_at_m{0};
     bool        standing_complete_m{false};
     bool        incoming_complete_m{false};
 };
 
 execution_t make_execution(const json_t& json);
 
+// An order request body serialized ahead of time for one account, venue,
+// symbol, direction and order type. Only the price and quantity are written
+// per order.
+struct order_template_t {
+    // Overwrites body (reusing its capacity) with the complete json request.
+    void render(std::size_t  price,
+                std::size_t  quantity,
+                std::string& body) const;
+
+    std::string prefix_m; // everything up to the price
+};
+
+order_template_t make_order_template(const std::string& account,
+                                     const std::string& venue,
+                                     const std::string& symbol,
+                                     direction_t        direction,
+                                     order_type_t       type);
+
+// Results of the nonblocking order apis. get() on the future either returns
+// the venue's response or throws the reason there isn't one. Handlers are
+// called on the io thread once the future is ready, so keep them short (or
+// push the work somewhere else.)
+typedef std::shared_future<order_book_t::value_type> order_future_t;
+typedef std::function<void (const order_future_t&)>  order_handler_t;
+typedef std::shared_future<json_t>                   cancel_future_t;
+typedef std::function<void (const cancel_future_t&)> cancel_handler_t;
+
+// Aggregate results of a batch of cancels.
+struct cancel_report_t {
+    typedef std::pair<std::size_t, std::string> failure_t; // order id, reason
+    typedef std::vector<failure_t>              failures_t;
+
+    std::size_t              requested_m{0};
+    std::size_t              canceled_m{0}; // acknowledged by the venue
+    failures_t               failures_m;
+    std::chrono::nanoseconds elapsed_m{0}; // first cancel sent to last reply
+    bool                     flat_m{false}; // no open orders left afterwards
+};
+
 struct engine_t {
     // instance related
     void start(const std::string& level_name); // initialize a new world instance on the service
@@ -176,8 +405,14 @@ struct engine_t {
     static json_t restart(std::size_t id);
     static json_t stop(std::size_t id);
     static json_t resume(std::size_t id);
+    void warm_up(std::size_t connections); // opens connections to both api hosts ahead of the first order
     void world_wide_wait(); // blocks until refresh() (called asynchronously) reports nonzero state
 
+    // In place of start(): trade against an in-process simulator instead of
+    // the service. Orders, cancels, depth and reconciliation become direct
+    // calls into it; refresh() does nothing. sim must outlive the engine.
+    void simulate(sim_exchange_t& sim);
+
     const std::string& venue() const;
     const std::string& symbol() const;
 
@@ -186,12 +421,24 @@ struct engine_t {
                        ticker_t&       old_ticker,
                        ticker_t&       cur_ticker);
 
-    ticker_t quote() const; // copy because threadsafe
+    ticker_t quote() const; // never blocks, never allocates
+
+    // full depth apis. refresh_depth polls the venue's order book for our
+    // symbol and applies whatever changed; returns the number of levels that
+    // did.
+    std::size_t  refresh_depth();
+    depth_book_t depth() const; // copy because threadsafe
+
+    // Brings the book in line with the venue's view of all our orders in our
+    // symbol there, in one request. Only orders the venue has further along
+    // (more filled, or closed) are rebuilt, so an execution that lands after
+    // the request isn't rolled back. Returns the number of orders patched.
+    std::size_t reconcile();
 
     // orderbook apis. All block while accessing the book.
-    void                     update_position(const order_key_t& key,
+    void                     update_position(order_key_t        key,
                                              const execution_t& execution);
-    bool                     own_order(const order_key_t& key) const; // O(log n)
+    bool                     own_order(order_key_t key) const; // O(1)
     holdings_t               holdings();
     order_book_t::value_type buy(std::size_t  price,
                                  std::size_t  quantity,
@@ -201,8 +448,24 @@ struct engine_t {
                                   order_type_t type);
 
     // nonblocking.
-    json_t cancel_nothrow(std::size_t order_id);
-    void   cancel(std::size_t order_id);
+    order_future_t buy_async(std::size_t     price,
+                             std::size_t     quantity,
+                             order_type_t    type,
+                             order_handler_t handler = order_handler_t());
+    order_future_t sell_async(std::size_t     price,
+                              std::size_t     quantity,
+                              order_type_t    type,
+                              order_handler_t handler = order_handler_t());
+
+    json_t          cancel_nothrow(std::size_t order_id);
+    void            cancel(std::size_t order_id);
+    cancel_future_t cancel_async(std::size_t      order_id,
+                                 cancel_handler_t handler = cancel_handler_t());
+
+    // Every cancel is in flight at once; these block until all have replied.
+    // Don't call them from the io thread.
+    cancel_report_t cancel_many(const std::vector<std::size_t>& order_ids);
+    cancel_report_t cancel_all_open();
 
     // instance related
     std::string               state_m;
@@ -216,10 +479,34 @@ struct engine_t {
 private:
     static std::string world_api(std::size_t id);
 
+    std::string        cancel_api(std::size_t order_id) const;
+    std::vector<std::size_t> open_order_ids() const; // on our venue
+    void               build_order_templates(); // once the venue and symbol are known
+    order_template_t&  order_template(direction_t direction, order_type_t type);
+    const std::string& render_order(std::size_t  price,
+                                    std::size_t  quantity,
+                                    order_type_t type,
+                                    direction_t  direction);
+
+    // validates the venue's response to an order and adds it to the book.
+    order_book_t::value_type order_complete(const json_t& json,
+                                            std::size_t   quantity,
+                                            order_type_t  type,
+                                            direction_t   direction);
+    order_book_t::value_type order_complete(order_book_t::value_type order,
+                                            std::size_t              quantity,
+                                            order_type_t             type,
+                                            direction_t              direction);
+
     order_book_t::value_type order(std::size_t  price,
                                    std::size_t  quantity,
                                    order_type_t type,
                                    direction_t  direction);
+    order_future_t           order_async(std::size_t     price,
+                                         std::size_t     quantity,
+                                         order_type_t    type,
+                                         direction_t     direction,
+                                         order_handler_t handler);
 
     stock_symbols_t          stock_symbols_m;
     venue_symbols_t          venue_symbols_m;
@@ -227,10 +514,19 @@ private:
     std::condition_variable  world_ready_m;
     bool                     done_m{false};
     std::atomic<bool>        ready_m{false};
-    ticker_t                 quote_m;
-    mutable mutex_t          quote_mutex_m;
+    ticker_t                 quote_m{}; // the writers' copy
+    mutex_t                  quote_mutex_m; // serializes writers
+    seqlock_t<ticker_t>      published_quote_m; // the readers' copy
+    depth_book_t             depth_m;
+    mutable mutex_t          depth_mutex_m;
     order_book_t             book_m;
     mutable mutex_t          book_mutex_m;
+    std::string              order_api_m;
+    order_template_t         order_templates_m[8]; // by direction, then type
+    sim_exchange_t*          sim_m{nullptr}; // the venue, when simulating
+    symbol_id_t              venue_id_m{0}; // interned once the world is known
+    symbol_id_t              symbol_id_m{0};
+    symbol_id_t              account_id_m{0};
 };
 
 /******************************************************************************/
@@ -0,0 +1,169 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef strand_hpp__
+#define strand_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// application
+#include "task_queue.hpp"
+
+/******************************************************************************/
+// A serial executor on top of a task_queue_t: the tasks pushed to a strand
+// run one at a time, in the order they were pushed, each on whichever worker
+// picks it up. Nothing waits on a worker in between. While the strand has
+// work it has exactly one task in the pool (in its lane), which runs the
+// oldest task and, if there are more, posts itself to the back of the lane
+// again. So a strand with a backlog takes its turn with everyone else instead
+// of holding onto a worker until it's caught up.
+//
+// A task that throws is dropped, as the pool would, and the strand carries
+// on. The strand must outlive the tasks pushed to it.
+
+struct strand_t {
+    typedef task_queue_t::task_t     task_t;
+    typedef std::mutex               mutex_t;
+    typedef std::lock_guard<mutex_t> lock_t;
+
+    explicit strand_t(task_queue_t& queue, priority_t priority = priority_t::normal) :
+        queue_m(queue),
+        priority_m(priority),
+        ring_m(16) {
+    }
+
+    template <typename F>
+    void push(F&& function) {
+        task_t task(std::forward<F>(function));
+        bool   schedule{false};
+
+        /* push lock scope */ {
+            lock_t lock{mutex_m};
+
+            if (size_m == ring_m.size())
+                grow();
+
+            ring_m[(head_m + size_m) & (ring_m.size() - 1)] = std::move(task);
+
+            ++size_m;
+
+            schedule = !scheduled_m;
+            scheduled_m = true;
+        }
+
+        if (schedule)
+            queue_m.push([this](){ run_one(); }, priority_m);
+    }
+
+    // Tasks waiting (counting the one running, if any.)
+    std::size_t depth() const {
+        lock_t lock{mutex_m};
+
+        return size_m;
+    }
+
+private:
+    strand_t(const strand_t&) = delete;
+    strand_t(strand_t&&) = delete;
+    strand_t& operator=(const strand_t&) = delete;
+    strand_t& operator=(strand_t&&) = delete;
+
+    // Doubles the ring (always a power of two), oldest task first.
+    void grow() {
+        std::vector<task_t> ring(ring_m.size() * 2);
+
+        for (std::size_t i(0); i < size_m; ++i) {
+            ring[i] = std::move(ring_m[(head_m + i) & (ring_m.size() - 1)]);
+        }
+
+        ring_m.swap(ring);
+
+        head_m = 0;
+    }
+
+    // The oldest task stays in the ring while it runs, so a push meanwhile
+    // sees the strand busy and leaves the scheduling to us.
+    void run_one() {
+        task_t task;
+
+        /* take lock scope */ {
+            lock_t lock{mutex_m};
+
+            task = std::move(ring_m[head_m]);
+        }
+
+        try {
+            task();
+        } catch (...) {
+            // Dropped, as the pool would; the rest of the strand still runs.
+        }
+
+        task.reset();
+
+        bool more{false};
+
+        /* done lock scope */ {
+            lock_t lock{mutex_m};
+
+            head_m = (head_m + 1) & (ring_m.size() - 1);
+
+            more = --size_m != 0;
+            scheduled_m = more;
+        }
+
+        if (more)
+            queue_m.post([this](){ run_one(); }, priority_m);
+    }
+
+    task_queue_t&       queue_m;
+    priority_t          priority_m;
+    mutable mutex_t     mutex_m;
+    std::vector<task_t> ring_m; // size is a power of two
+    std::size_t         head_m{0}; // the oldest (or running) task
+    std::size_t         size_m{0};
+    bool                scheduled_m{false};
+};
+
+/******************************************************************************/
+// Strands by key (a stream, say), each made on first use (at the priority
+// asked for then) and kept for as long as the map is. Look one up once and
+// hold onto it: the lookup takes a lock, but a strand_t& stays good.
+
+struct strand_map_t {
+    typedef std::uint64_t key_t;
+
+    explicit strand_map_t(task_queue_t& queue) : queue_m(queue) { }
+
+    strand_t& get(key_t key, priority_t priority = priority_t::normal) {
+        std::lock_guard<std::mutex> lock{mutex_m};
+        std::unique_ptr<strand_t>&  result = strands_m[key];
+
+        if (!result)
+            result.reset(new strand_t(queue_m, priority));
+
+        return *result;
+    }
+
+private:
+    task_queue_t&                                        queue_m;
+    std::mutex                                           mutex_m;
+    std::unordered_map<key_t, std::unique_ptr<strand_t>> strands_m;
+};
+
+/******************************************************************************/
+
+#endif // strand_hpp__
+
+/******************************************************************************/
@@ -22,10 +22,17 @@
 
 #define qDebugOff (qDebug && 0)
 
+// Check the running holdings against a recount of every order on each read.
+#define qAuditHoldings qDebug
+
 #if BOOST_OS_MACOS
     #define qMac 1
 #endif
 
+#if BOOST_ARCH_X86
+    #define qX86 1
+#endif
+
 /******************************************************************************/
 
 #endif // switches_hpp__
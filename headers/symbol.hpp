@@ -0,0 +1,51 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef symbol_hpp__
+#define symbol_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <string>
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+// The process-wide symbol table: venue, stock and account names, each kept
+// once and known everywhere else by a small integer id. Comparing two of them
+// is an integer compare, and orders and executions carry ids instead of their
+// own copies of the names.
+//
+// Ids are handed out densely in order of first use, and are good for the rest
+// of the process, as are the names they refer to. Id 0 is the empty name, so a
+// zeroed id is no name at all. Threadsafe.
+
+typedef std::uint16_t symbol_id_t;
+
+// The id for the name, adding it if it's new. Throws once the table is full.
+symbol_id_t intern_symbol(const char* first, std::size_t size);
+
+inline symbol_id_t intern_symbol(const std::string& name) {
+    return intern_symbol(name.data(), name.size());
+}
+
+// The name for the id, which must have come from intern_symbol.
+const std::string& symbol_name(symbol_id_t id);
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
+
+#endif // symbol_hpp__
+
+/******************************************************************************/
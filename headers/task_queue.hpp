@@ -11,52 +11,240 @@
 /******************************************************************************/
 
 // stdc++
-#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 // application
+#include "histogram.hpp"
 #include "switches.hpp"
+#include "unique_function.hpp"
+
+#if qX86
+    #include <immintrin.h>
+#endif
+
+/******************************************************************************/
+
+enum class priority_t {
+    critical,  // executions and cancels
+    normal,    // ticks, orders, the console
+    background // logging, reconciliation, housekeeping
+};
+
+constexpr std::size_t priority_count_k = static_cast<std::size_t>(priority_t::background) + 1;
+
+inline const char* priority_name(priority_t priority) {
+    switch (priority) {
+        case priority_t::critical: return "CRIT";
+        case priority_t::normal: return "NORM";
+        default: return "BKGD";
+    }
+}
 
 /******************************************************************************/
+// How a pool's idle workers wait for work. Each looks for it, and between
+// looks first spins (spin_m times), then yields the CPU (yield_m times), then
+// parks until the next push. Spinning and yielding trade CPU for not paying a
+// futex wake and a trip through the scheduler when work does come.
+//
+// The first hot_m workers (at most all but one) never park, and only ever
+// take work from the critical lane: they spin on it, so an execution never
+// waits on a wake, or on a worker busy with something else. The default is
+// to park straight away, with no hot workers.
+
+struct idle_policy_t {
+    std::size_t spin_m{0};
+    std::size_t yield_m{0};
+    std::size_t hot_m{0};
+};
+
+/******************************************************************************/
+// A work-stealing thread pool. Each worker owns a Chase-Lev deque: tasks a
+// worker pushes go on the bottom of its own deque, and it pops them back off
+// the bottom (newest first, while they're still warm) without contending with
+// anyone. A worker that runs dry takes from the injection queue, where tasks
+// pushed from outside the pool (the recur engine, the console, the websocket
+// handlers) land, and then tries to steal the oldest task off the top of other
+// workers' deques, picked at random. Nothing to steal anywhere, and it parks
+// until the next push.
+//
+// Every priority is its own lane, with its own deque per worker and its own
+// injection queue, and workers look for work a lane at a time, highest first.
+// So that a busy high lane can't shut a lower one out for good, a lane that
+// has had work waiting while starvation_k tasks in a row were taken from above
+// it goes first next time.
+//
+// Pushes and pops are lock-free; the lock is only for parking and waking.
+//
+// Tasks are move-only, and moved (never copied) from push() to the worker
+// that runs them. The closures the app pushes fit a task_t's inline storage,
+// so the only allocations left are the deques' nodes, which each worker
+// recycles: a push from outside the pool moves the task straight into an
+// injection queue cell, and one from a worker reuses a node it ran earlier.
 
 struct task_queue_t {
-    typedef std::function<void ()>    task_t;
+    typedef unique_function<void ()>  task_t;
     typedef std::mutex                mutex_t;
     typedef std::unique_lock<mutex_t> lock_t;
-    typedef std::deque<task_t>        task_deque_t;
 
-    task_queue_t(std::size_t pool_size = std::thread::hardware_concurrency()) {
+    task_queue_t(std::size_t   pool_size = std::thread::hardware_concurrency(),
+                 idle_policy_t policy = idle_policy_t()) :
+        policy_m(policy) {
+        policy_m.hot_m = std::min(policy_m.hot_m, pool_size ? pool_size - 1 : 0);
+
+        for (std::size_t i(0); i < pool_size; ++i) {
+            workers_m.emplace_back(new worker_t(i + 1));
+        }
+
         for (std::size_t i(0); i < pool_size; ++i) {
-            pool_m.emplace_back(std::bind(&task_queue_t::worker, this));
+            pool_m.emplace_back(std::bind(&task_queue_t::worker, this, i));
         }
     }
 
     ~task_queue_t() {
-        lock_t lock{mutex_m};
-
         signal_done();
 
-        lock.unlock();
-
         for (auto& thread : pool_m) {
             thread.join();
         }
+
+        // Whatever was still queued is dropped, as it always has been. (The
+        // injection queues' cells go with them.)
+        for (std::size_t lane(0); lane < priority_count_k; ++lane) {
+            for (auto& worker : workers_m) {
+                while (node_t* node = worker->deques_m[lane].pop())
+                    delete node;
+            }
+        }
     }
 
     template <typename F>
     void push(F&& function, priority_t priority = priority_t::normal) {
-        lock_t lock{mutex_m};
+        std::size_t lane = static_cast<std::size_t>(priority);
+        worker_t*   self = current() == this ? workers_m[current_index()].get() : nullptr;
 
-        deque_m.emplace_back(std::forward<F>(function));
+        if (self) {
+            node_t* node = self->node(std::forward<F>(function), stamp(lane));
 
-        condition_m.notify_one();
+            queued(lanes_m[lane]);
+
+            self->deques_m[lane].push(node);
+        } else {
+            task_t       task(std::forward<F>(function));
+            std::int64_t pushed = stamp(lane);
+
+            queued(lanes_m[lane]);
+
+            while (!lanes_m[lane].injection_m.push(task, pushed))
+                std::this_thread::yield();
+        }
+
+        wake();
+    }
+
+    // Like push(), but to the back of the lane's injection queue even from a
+    // worker, so the task waits its turn behind everything already queued
+    // instead of being the worker's next. (Should the queue be full, a
+    // worker falls back to its own deque rather than wait on itself.)
+    template <typename F>
+    void post(F&& function, priority_t priority = priority_t::normal) {
+        std::size_t  lane = static_cast<std::size_t>(priority);
+        worker_t*    self = current() == this ? workers_m[current_index()].get() : nullptr;
+        task_t       task(std::forward<F>(function));
+        std::int64_t pushed = stamp(lane);
+
+        queued(lanes_m[lane]);
+
+        while (!lanes_m[lane].injection_m.push(task, pushed)) {
+            if (self) {
+                self->deques_m[lane].push(self->node(std::move(task), pushed));
+
+                break;
+            }
+
+            std::this_thread::yield();
+        }
+
+        wake();
+    }
+
+    std::size_t size() const {
+        return pool_m.size();
+    }
+
+    // Tasks waiting in the lane now, and the most there have been at once.
+    std::size_t depth(priority_t priority) const {
+        return lanes_m[static_cast<std::size_t>(priority)].depth_m.load(std::memory_order_relaxed);
+    }
+
+    std::size_t peak(priority_t priority) const {
+        return lanes_m[static_cast<std::size_t>(priority)].peak_m.load(std::memory_order_relaxed);
+    }
+
+    // One line per lane.
+    std::vector<std::string> lane_report() const {
+        std::vector<std::string> result;
+
+        for (std::size_t lane(0); lane < priority_count_k; ++lane) {
+            const lane_t& entry = lanes_m[lane];
+
+            result.push_back(std::string("LANE : ") + priority_name(static_cast<priority_t>(lane)) +
+                             " : DPTH : " + std::to_string(entry.depth_m.load(std::memory_order_relaxed)) +
+                             " : PEAK : " + std::to_string(entry.peak_m.load(std::memory_order_relaxed)) +
+                             " : RUNN : " + std::to_string(entry.ran_m.load(std::memory_order_relaxed)));
+        }
+
+        return result;
+    }
+
+    const idle_policy_t& policy() const {
+        return policy_m;
+    }
+
+    // How long, after a push, the idle worker that took it had it in hand;
+    // a line per way of waiting it was caught in.
+    std::vector<std::string> wake_report() const {
+        std::vector<std::string> result;
+
+        for (std::size_t i(0); i < wait_count_k; ++i) {
+            latency_histogram_t::summary_t summary = wake_latency_m[i].summary();
+            std::stringstream              stream;
+
+            if (!summary.count_m)
+                continue;
+
+            stream << "WAKE : " << wait_name(static_cast<wait_t>(i))
+                   << " : N : " << summary.count_m
+                   << " : P50 : " << summary.p50_m
+                   << " : P99 : " << summary.p99_m
+                   << " : P999 : " << summary.p999_m
+                   << " : MAX : " << summary.max_m
+                   << " : MEAN : " << summary.mean_m
+                   << " (ns)";
+
+            result.push_back(stream.str());
+        }
+
+        return result;
     }
 
     void signal_done() {
         if (done_m.exchange(true))
             return;
 
+        lock_t lock{mutex_m};
+
         condition_m.notify_all();
     }
 
@@ -66,53 +254,561 @@ private:
     task_queue_t& operator=(const task_queue_t&) = delete;
     task_queue_t& operator=(task_queue_t&&) = delete;
 
-    void worker() {
-        task_t task;
+    /**************************************************************************/
+    // A task a worker pushed to its own deque, and when (if a worker was idle
+    // to take it; zero if not.)
 
-        while (true) try {
-#if qMac
-            pthread_setname_np("wait : worker");
-#endif
-            lock_t lock{mutex_m};
+    struct node_t {
+        task_t       task_m;
+        std::int64_t pushed_m;
+    };
 
-            condition_m.wait(lock, [=](){ return done_m || !empty_unsafe(); });
+    /**************************************************************************/
+    // The Chase-Lev deque, with the C11 orderings from Le, Pop, Cohen and
+    // Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+    // Models". The owner pushes and pops the bottom; anyone steals the top.
+    // Outgrown arrays are kept until the deque goes, since a thief may still
+    // be reading one.
 
-            if (done_m)
-                return;
+    struct deque_t {
+        deque_t() {
+            arrays_m.emplace_back(new array_t(64));
 
-            if (try_pop_unsafe(task)) {
-                lock.unlock();
-#if qMac
-                pthread_setname_np("RUNN : worker");
-#endif
-                task();
+            array_m.store(arrays_m.back().get(), std::memory_order_relaxed);
+        }
+
+        void push(node_t* task) { // owner only
+            std::int64_t bottom = bottom_m.load(std::memory_order_relaxed);
+            std::int64_t top = top_m.load(std::memory_order_acquire);
+            array_t*     array = array_m.load(std::memory_order_relaxed);
+
+            if (bottom - top > static_cast<std::int64_t>(array->mask_m))
+                array = grow(array, top, bottom);
+
+            array->put(bottom, task);
+
+            std::atomic_thread_fence(std::memory_order_release);
+
+            bottom_m.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        node_t* pop() { // owner only
+            std::int64_t bottom = bottom_m.load(std::memory_order_relaxed) - 1;
+            array_t*     array = array_m.load(std::memory_order_relaxed);
+
+            bottom_m.store(bottom, std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            std::int64_t top = top_m.load(std::memory_order_relaxed);
+            node_t*      result = nullptr;
+
+            if (top <= bottom) {
+                result = array->get(bottom);
+
+                if (top == bottom) {
+                    // The last one; race the thieves for it.
+                    if (!top_m.compare_exchange_strong(top,
+                                                       top + 1,
+                                                       std::memory_order_seq_cst,
+                                                       std::memory_order_relaxed))
+                        result = nullptr;
+
+                    bottom_m.store(bottom + 1, std::memory_order_relaxed);
+                }
+            } else {
+                bottom_m.store(bottom + 1, std::memory_order_relaxed);
             }
-        } catch (...) {
-            // Drop it on the floor. Not ideal, but really there's nowhere
-            // for them to go right now.
+
+            return result;
+        }
+
+        node_t* steal() { // anyone
+            std::int64_t top = top_m.load(std::memory_order_acquire);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            std::int64_t bottom = bottom_m.load(std::memory_order_acquire);
+
+            if (top >= bottom)
+                return nullptr;
+
+            node_t* result = array_m.load(std::memory_order_acquire)->get(top);
+
+            if (!top_m.compare_exchange_strong(top,
+                                               top + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed))
+                return nullptr; // lost it to the owner or another thief
+
+            return result;
+        }
+
+    private:
+        struct array_t {
+            explicit array_t(std::size_t size) :
+                mask_m(size - 1),
+                slots_m(new std::atomic<node_t*>[size]) {
+            }
+
+            node_t* get(std::int64_t i) const {
+                return slots_m[static_cast<std::size_t>(i) & mask_m].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t i, node_t* task) {
+                slots_m[static_cast<std::size_t>(i) & mask_m].store(task, std::memory_order_relaxed);
+            }
+
+            std::size_t                             mask_m; // size - 1; size is a power of two
+            std::unique_ptr<std::atomic<node_t*>[]> slots_m;
+        };
+
+        array_t* grow(array_t* array, std::int64_t top, std::int64_t bottom) {
+            arrays_m.emplace_back(new array_t((array->mask_m + 1) * 2));
+
+            array_t* result = arrays_m.back().get();
+
+            for (std::int64_t i(top); i < bottom; ++i) {
+                result->put(i, array->get(i));
+            }
+
+            array_m.store(result, std::memory_order_release);
+
+            return result;
+        }
+
+        std::atomic<std::int64_t>             top_m{0};
+        std::atomic<std::int64_t>             bottom_m{0};
+        std::atomic<array_t*>                 array_m;
+        std::vector<std::unique_ptr<array_t>> arrays_m; // owner only
+    };
+
+    /**************************************************************************/
+    // Tasks from outside the pool: a bounded multi-producer, multi-consumer
+    // ring (Vyukov's), where each cell's sequence number says whose turn it
+    // is. A full ring fails the push (leaving the task where it was), and
+    // push() yields until a worker makes room. The tasks (and when they were
+    // pushed) live in the cells.
+
+    struct injection_t {
+        injection_t() :
+            cells_m(new cell_t[size_k]) {
+            for (std::size_t i(0); i < size_k; ++i) {
+                cells_m[i].sequence_m.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        bool push(task_t& task, std::int64_t pushed) {
+            std::size_t position = enqueue_m.load(std::memory_order_relaxed);
+            cell_t*     cell;
+
+            while (true) {
+                cell = &cells_m[position & (size_k - 1)];
+
+                std::size_t    sequence = cell->sequence_m.load(std::memory_order_acquire);
+                std::ptrdiff_t turn = static_cast<std::ptrdiff_t>(sequence - position);
+
+                if (turn == 0) {
+                    if (enqueue_m.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                } else if (turn < 0) {
+                    return false; // full
+                } else {
+                    position = enqueue_m.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->task_m = std::move(task);
+            cell->pushed_m = pushed;
+            cell->sequence_m.store(position + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool pop(task_t& task, std::int64_t& pushed) {
+            std::size_t position = dequeue_m.load(std::memory_order_relaxed);
+            cell_t*     cell;
+
+            while (true) {
+                cell = &cells_m[position & (size_k - 1)];
+
+                std::size_t    sequence = cell->sequence_m.load(std::memory_order_acquire);
+                std::ptrdiff_t turn = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+
+                if (turn == 0) {
+                    if (dequeue_m.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                } else if (turn < 0) {
+                    return false; // empty
+                } else {
+                    position = dequeue_m.load(std::memory_order_relaxed);
+                }
+            }
+
+            task = std::move(cell->task_m);
+            pushed = cell->pushed_m;
+            cell->sequence_m.store(position + size_k, std::memory_order_release);
+
+            return true;
         }
+
+    private:
+        static constexpr std::size_t size_k = 4096; // a power of two
+
+        struct cell_t {
+            std::atomic<std::size_t> sequence_m;
+            task_t                   task_m;
+            std::int64_t             pushed_m{0};
+        };
+
+        std::unique_ptr<cell_t[]> cells_m;
+        std::atomic<std::size_t>  enqueue_m{0};
+        std::atomic<std::size_t>  dequeue_m{0};
+    };
+
+    /**************************************************************************/
+
+    struct worker_t {
+        explicit worker_t(std::uint64_t seed) : random_m(seed) {
+            spare_m.reserve(spare_k);
+        }
+
+        ~worker_t() {
+            for (node_t* node : spare_m) {
+                delete node;
+            }
+        }
+
+        // A deque node holding the task, reusing a spare if there is one.
+        template <typename F>
+        node_t* node(F&& function, std::int64_t pushed) {
+            if (spare_m.empty())
+                return new node_t{ task_t(std::forward<F>(function)), pushed };
+
+            node_t* result = spare_m.back();
+
+            spare_m.pop_back();
+
+            result->task_m = task_t(std::forward<F>(function));
+            result->pushed_m = pushed;
+
+            return result;
+        }
+
+        // Moves the task out of a node taken off a deque (this worker's or
+        // not), and keeps the node for this worker's next push.
+        void recycle(node_t* node, task_t& task, std::int64_t& pushed) {
+            task = std::move(node->task_m);
+            pushed = node->pushed_m;
+
+            if (spare_m.size() < spare_k) {
+                spare_m.push_back(node);
+            } else {
+                delete node;
+            }
+        }
+
+        // xorshift64, to pick victims
+        std::size_t next_victim(std::size_t count) {
+            random_m ^= random_m << 13;
+            random_m ^= random_m >> 7;
+            random_m ^= random_m << 17;
+
+            return static_cast<std::size_t>(random_m % count);
+        }
+
+        static constexpr std::size_t spare_k = 256;
+
+        deque_t              deques_m[priority_count_k]; // by lane
+        std::size_t          passed_m[priority_count_k]{}; // by lane: times in a row passed over with work waiting
+        std::uint64_t        random_m;
+        std::vector<node_t*> spare_m; // empty nodes, at most spare_k
+    };
+
+    /**************************************************************************/
+
+    struct lane_t {
+        injection_t              injection_m;
+        std::atomic<std::size_t> depth_m{0}; // queued and not yet taken
+        std::atomic<std::size_t> peak_m{0};
+        std::atomic<std::size_t> ran_m{0};
+    };
+
+    static constexpr std::size_t starvation_k = 32;
+
+    // Counted before the task is queued, so a taker never sees it negative.
+    static void queued(lane_t& lane) {
+        std::size_t depth = lane.depth_m.fetch_add(1, std::memory_order_relaxed) + 1;
+        std::size_t peak = lane.peak_m.load(std::memory_order_relaxed);
+
+        while (depth > peak && !lane.peak_m.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+            ;
     }
 
-    bool empty_unsafe() const {
-        return deque_m.empty();
+    /**************************************************************************/
+    // Which pool (and which worker in it) the calling thread is, if any.
+
+    static const task_queue_t*& current() {
+        thread_local const task_queue_t* current_s{nullptr};
+
+        return current_s;
     }
 
-    bool try_pop_unsafe(task_t& task) {
-        if (deque_m.empty())
+    static std::size_t& current_index() {
+        thread_local std::size_t index_s{0};
+
+        return index_s;
+    }
+
+    /**************************************************************************/
+    // Within a lane: own deque first, then the outside world, then everyone
+    // else's deques starting from a random one. An empty lane isn't searched
+    // at all; one pushed to meanwhile bumps the epoch, so the worker won't
+    // park on it.
+
+    bool take(std::size_t index, std::size_t lane, task_t& task, std::int64_t& pushed) {
+        if (!lanes_m[lane].depth_m.load(std::memory_order_relaxed))
             return false;
 
-        task = deque_m.front();
+        worker_t& self = *workers_m[index];
+        node_t*   node = self.deques_m[lane].pop();
+
+        if (!node && lanes_m[lane].injection_m.pop(task, pushed))
+            return true;
+
+        std::size_t count = workers_m.size();
+        std::size_t first = self.next_victim(count);
 
-        deque_m.pop_front();
+        for (std::size_t i(0); !node && i < count; ++i) {
+            std::size_t victim = (first + i) % count;
+
+            if (victim != index)
+                node = workers_m[victim]->deques_m[lane].steal();
+        }
+
+        if (!node)
+            return false;
+
+        self.recycle(node, task, pushed);
+
+        return true;
+    }
+
+    /**************************************************************************/
+    // The lowest starving lane, if there is one, and then strictly by
+    // priority. Only the first lane_count lanes are looked at. pushed is when
+    // the task found was pushed, or zero if no one was idle then.
+
+    bool find_task(std::size_t   index,
+                   task_t&       task,
+                   std::int64_t& pushed,
+                   std::size_t   lane_count = priority_count_k) {
+        worker_t&   self = *workers_m[index];
+        std::size_t first = 0;
+
+        for (std::size_t lane(lane_count - 1); lane != 0; --lane) {
+            if (self.passed_m[lane] >= starvation_k) {
+                first = lane;
+
+                break;
+            }
+        }
+
+        std::size_t lane = first;
+        bool        found = take(index, lane, task, pushed);
+
+        for (std::size_t i(0); !found && i < lane_count; ++i) {
+            if (i != first && (found = take(index, i, task, pushed)))
+                lane = i;
+        }
+
+        if (!found)
+            return false;
+
+        lanes_m[lane].depth_m.fetch_sub(1, std::memory_order_relaxed);
+        lanes_m[lane].ran_m.fetch_add(1, std::memory_order_relaxed);
+
+        for (std::size_t i(0); i < lane_count; ++i) {
+            if (i == lane) {
+                self.passed_m[i] = 0;
+            } else if (i > lane) {
+                bool waiting = lanes_m[i].depth_m.load(std::memory_order_relaxed) != 0;
+
+                self.passed_m[i] = waiting ? self.passed_m[i] + 1 : 0;
+            }
+        }
 
         return true;
     }
 
-    task_deque_t             deque_m;
-    std::vector<std::thread> pool_m;
-    std::condition_variable  condition_m;
-    mutex_t                  mutex_m;
-    std::atomic<bool>        done_m{false};
+    /**************************************************************************/
+    // Wake-to-run latency. A push that an idle worker might take notes the
+    // time in the task, and an idle worker that comes up with a task measures
+    // from when that task was pushed (if since it went idle; any older and it
+    // isn't what woke the worker.) It's by the way the worker was waiting
+    // when it found it.
+
+    enum class wait_t {
+        spin,
+        yield,
+        park
+    };
+
+    static constexpr std::size_t wait_count_k = static_cast<std::size_t>(wait_t::park) + 1;
+
+    static const char* wait_name(wait_t wait) {
+        switch (wait) {
+            case wait_t::spin: return "SPIN";
+            case wait_t::yield: return "YILD";
+            default: return "PARK";
+        }
+    }
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // The time now if an idle worker might take from the lane, else zero
+    // (and no clock read.) Hot workers are idle whenever they aren't running
+    // something, so a pool with any reads the clock on every critical push;
+    // they don't count toward idle_m, so it doesn't on the other lanes.
+    std::int64_t stamp(std::size_t lane) const {
+        bool watched = idle_m.load(std::memory_order_seq_cst) != 0 ||
+                       (lane == static_cast<std::size_t>(priority_t::critical) && policy_m.hot_m != 0);
+
+        return watched ? now_ns() : 0;
+    }
+
+    static void relax() {
+#if qX86
+        _mm_pause();
+#endif
+    }
+
+    /**************************************************************************/
+    // An idle spell: look for work, spin, yield or park per the policy, and
+    // look again, until there's a task (true) or the pool is done (false.)
+    // The epoch is read before each look, so a push that the look misses
+    // still keeps the worker from parking.
+
+    bool wait_for_task(std::size_t index, task_t& task) {
+        bool         hot = index < policy_m.hot_m;
+        std::size_t  lane_count = hot ? 1 : priority_count_k;
+        std::int64_t since = now_ns();
+        std::int64_t pushed{0};
+        wait_t       wait = wait_t::spin;
+        bool         found = false;
+
+        if (!hot)
+            idle_m.fetch_add(1, std::memory_order_seq_cst);
+
+        for (std::size_t round(0); !done_m; ++round) {
+            std::size_t epoch = epoch_m.load(std::memory_order_seq_cst);
+
+            if ((found = find_task(index, task, pushed, lane_count)))
+                break;
+
+            if (hot || round < policy_m.spin_m) {
+                wait = wait_t::spin;
+
+                relax();
+            } else if (round < policy_m.spin_m + policy_m.yield_m) {
+                wait = wait_t::yield;
+
+                std::this_thread::yield();
+            } else {
+                wait = wait_t::park;
+
+                park(epoch);
+            }
+        }
+
+        if (!hot)
+            idle_m.fetch_sub(1, std::memory_order_seq_cst);
+
+        if (found && pushed >= since)
+            wake_latency_m[static_cast<std::size_t>(wait)].record(static_cast<std::uint64_t>(now_ns() - pushed));
+
+        return found;
+    }
+
+    /**************************************************************************/
+    // Pushes bump the epoch after queueing, and only take the lock when
+    // someone is parked. A worker counts itself parked before its final look
+    // at the epoch, so one of the two always sees the other.
+
+    void wake() {
+        epoch_m.fetch_add(1, std::memory_order_seq_cst);
+
+        if (parked_m.load(std::memory_order_seq_cst) == 0)
+            return;
+
+        lock_t lock{mutex_m};
+
+        condition_m.notify_one();
+    }
+
+    void park(std::size_t epoch) {
+        lock_t lock{mutex_m};
+
+        parked_m.fetch_add(1, std::memory_order_seq_cst);
+
+        condition_m.wait(lock, [=](){
+            return done_m || epoch_m.load(std::memory_order_seq_cst) != epoch;
+        });
+
+        parked_m.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    /**************************************************************************/
+
+    void worker(std::size_t index) {
+        current() = this;
+        current_index() = index;
+
+        task_t       task;
+        std::int64_t pushed{0}; // only measured while idle
+        std::size_t  lane_count = index < policy_m.hot_m ? 1 : priority_count_k;
+
+        while (true) try {
+            if (done_m)
+                return;
+
+            if (!find_task(index, task, pushed, lane_count)) {
+#if qMac
+                pthread_setname_np("wait : worker");
+#endif
+                if (!wait_for_task(index, task))
+                    continue;
+            }
+
+#if qMac
+            pthread_setname_np("RUNN : worker");
+#endif
+            task();
+
+            task.reset();
+        } catch (...) {
+            // Drop it on the floor. Not ideal, but really there's nowhere
+            // for them to go right now.
+            task.reset();
+        }
+    }
+
+    /**************************************************************************/
+
+    idle_policy_t                          policy_m;
+    std::vector<std::unique_ptr<worker_t>> workers_m; // by worker index
+    lane_t                                 lanes_m[priority_count_k];
+    std::vector<std::thread>               pool_m;
+    std::condition_variable                condition_m;
+    mutex_t                                mutex_m; // parking only
+    std::atomic<std::size_t>               epoch_m{0}; // pushes so far
+    std::atomic<std::size_t>               parked_m{0};
+    std::atomic<std::size_t>               idle_m{0}; // spinning, yielding or parked, but not hot
+    latency_histogram_t                    wake_latency_m[wait_count_k]; // by wait_t
+    std::atomic<bool>                      done_m{false};
 };
 
 /******************************************************************************/
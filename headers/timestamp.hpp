@@ -0,0 +1,49 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef timestamp_hpp__
+#define timestamp_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <string>
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+// The venue stamps everything with ISO-8601 UTC text, to the nanosecond, e.g.,
+// 2015-12-05T21:36:30.196410227Z. We keep it as nanoseconds since the Unix
+// epoch: ordering two of them is an integer compare, and formatting is only
+// for logs and the wire. 0 means no time (e.g., there's been no last trade.)
+
+typedef std::int64_t timestamp_t;
+
+// The fixed format above, with anywhere from none to nine fractional digits.
+// Returns false (leaving result alone) if the text is anything else.
+bool parse_timestamp(const char* first, std::size_t size, timestamp_t& result);
+
+// Same, but 0 for anything that isn't a timestamp, the empty string included.
+timestamp_t parse_timestamp(const std::string& text);
+
+// Always with nine fractional digits; the empty string for 0.
+std::string format_timestamp(timestamp_t timestamp);
+
+timestamp_t now_timestamp(); // the system clock
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
+
+#endif // timestamp_hpp__
+
+/******************************************************************************/
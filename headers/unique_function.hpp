@@ -0,0 +1,205 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef unique_function_hpp__
+#define unique_function_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/******************************************************************************/
+// A callable wrapper like std::function, except that it can only be moved,
+// never copied. That lets it hold move-only closures, and lets handing one
+// along (into a queue, out to a worker) be a move rather than a copy of
+// everything the closure captured.
+//
+// Closures up to capacity_k bytes (and no fussier about alignment than
+// max_align_t, and nothrow to move) live inline, so wrapping one allocates
+// nothing; bigger ones go on the heap, and a move is then just the pointer.
+// Calling an empty one throws std::bad_function_call.
+
+template <typename Signature>
+struct unique_function;
+
+template <typename R, typename... Args>
+struct unique_function<R (Args...)> {
+    static constexpr std::size_t capacity_k = 64;
+
+    unique_function() = default;
+
+    unique_function(std::nullptr_t) { }
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, unique_function>::value>::type>
+    unique_function(F&& f) {
+        typedef typename std::decay<F>::type functor_t;
+
+        construct<functor_t>(std::forward<F>(f), std::integral_constant<bool, fits<functor_t>()>());
+    }
+
+    unique_function(unique_function&& rhs) noexcept {
+        take(rhs);
+    }
+
+    unique_function& operator=(unique_function&& rhs) noexcept {
+        if (this != &rhs) {
+            reset();
+
+            take(rhs);
+        }
+
+        return *this;
+    }
+
+    ~unique_function() {
+        reset();
+    }
+
+    explicit operator bool() const {
+        return ops_m != nullptr;
+    }
+
+    R operator()(Args... args) {
+        if (!ops_m)
+            throw std::bad_function_call();
+
+        return ops_m->invoke_m(&storage_m, std::forward<Args>(args)...);
+    }
+
+    void reset() {
+        if (!ops_m)
+            return;
+
+        ops_m->destroy_m(&storage_m);
+
+        ops_m = nullptr;
+    }
+
+    // Whether the closure is held inline (for the benches.)
+    bool inline_storage() const {
+        return ops_m && ops_m->inline_m;
+    }
+
+private:
+    unique_function(const unique_function&) = delete;
+    unique_function& operator=(const unique_function&) = delete;
+
+    typedef typename std::aligned_storage<capacity_k, alignof(std::max_align_t)>::type storage_t;
+
+    // One of these per closure type, shared by every wrapper holding one.
+    struct ops_t {
+        R    (*invoke_m)(void*, Args&&...);
+        void (*move_m)(void* from, void* to) noexcept; // leaves from destroyed
+        void (*destroy_m)(void*) noexcept;
+        bool inline_m;
+    };
+
+    template <typename F>
+    static constexpr bool fits() {
+        return sizeof(F) <= capacity_k &&
+               alignof(F) <= alignof(storage_t) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+    /**************************************************************************/
+
+    template <typename F>
+    struct inline_t {
+        static F& get(void* storage) {
+            return *static_cast<F*>(storage);
+        }
+
+        static R invoke(void* storage, Args&&... args) {
+            return get(storage)(std::forward<Args>(args)...);
+        }
+
+        static void move(void* from, void* to) noexcept {
+            ::new (to) F(std::move(get(from)));
+
+            get(from).~F();
+        }
+
+        static void destroy(void* storage) noexcept {
+            get(storage).~F();
+        }
+
+        static const ops_t* ops() {
+            static const ops_t ops_s{ &invoke, &move, &destroy, true };
+
+            return &ops_s;
+        }
+    };
+
+    template <typename F>
+    struct heap_t {
+        static F*& get(void* storage) {
+            return *static_cast<F**>(storage);
+        }
+
+        static R invoke(void* storage, Args&&... args) {
+            return (*get(storage))(std::forward<Args>(args)...);
+        }
+
+        static void move(void* from, void* to) noexcept {
+            ::new (to) F*(get(from));
+        }
+
+        static void destroy(void* storage) noexcept {
+            delete get(storage);
+        }
+
+        static const ops_t* ops() {
+            static const ops_t ops_s{ &invoke, &move, &destroy, false };
+
+            return &ops_s;
+        }
+    };
+
+    /**************************************************************************/
+
+    template <typename F, typename G>
+    void construct(G&& f, std::true_type) {
+        ::new (static_cast<void*>(&storage_m)) F(std::forward<G>(f));
+
+        ops_m = inline_t<F>::ops();
+    }
+
+    template <typename F, typename G>
+    void construct(G&& f, std::false_type) {
+        ::new (static_cast<void*>(&storage_m)) F*(new F(std::forward<G>(f)));
+
+        ops_m = heap_t<F>::ops();
+    }
+
+    void take(unique_function& rhs) noexcept {
+        if (!rhs.ops_m)
+            return;
+
+        rhs.ops_m->move_m(&rhs.storage_m, &storage_m);
+
+        ops_m = rhs.ops_m;
+        rhs.ops_m = nullptr;
+    }
+
+    /**************************************************************************/
+
+    storage_t    storage_m;
+    const ops_t* ops_m{nullptr};
+};
+
+/******************************************************************************/
+
+#endif // unique_function_hpp__
+
+/******************************************************************************/
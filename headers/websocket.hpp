@@ -26,7 +26,7 @@ struct websocket_t {
     typedef std::function<void (const std::string&)> pong_timeout_handler_t;
     typedef std::function<bool ()>                   validate_handler_t;
     typedef std::function<void ()>                   http_handler_t;
-    typedef std::function<void (const std::string&)> message_handler_t;
+    typedef std::function<void (std::string)>        message_handler_t; // the handler's to keep
 
     websocket_t();
 
@@ -47,8 +47,6 @@ struct websocket_t {
 
     bool connected() const;
 
-    void poll();
-
     void disconnect();
 
 private:
@@ -0,0 +1,135 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "bots.hpp"
+
+// stdc++
+#include <deque>
+#include <random>
+
+// application
+#include "exchange.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+const std::size_t max_open_k = 20; // resting quotes per bot
+
+/******************************************************************************/
+
+std::string account(std::size_t bot) {
+    return "BOT" + std::to_string(bot);
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace mock {
+
+/******************************************************************************/
+
+bots_t::bots_t(exchange_t& exchange, std::size_t count, std::uint64_t seed) :
+    exchange_m(exchange) {
+    for (std::size_t i(0); i < count; ++i) {
+        exchange_m.add_background_account(account(i));
+
+        threads_m.emplace_back([=](){ trade(i, seed + i); });
+    }
+}
+
+/******************************************************************************/
+
+bots_t::~bots_t() {
+    done_m = true;
+
+    for (auto& thread : threads_m) {
+        thread.join();
+    }
+}
+
+/******************************************************************************/
+
+void bots_t::trade(std::size_t bot, std::uint64_t seed) {
+    typedef std::uniform_int_distribution<std::size_t> uniform_t;
+
+    std::mt19937_64             random(seed);
+    std::bernoulli_distribution coin(0.5);
+    uniform_t                   pause(5, 50); // ms between actions
+    uniform_t                   action(0, 99);
+    uniform_t                   offset(1, 40); // cents from fair value
+    uniform_t                   size(1, 100);
+    std::string                 account(::account(bot));
+    std::deque<std::size_t>     open;
+
+    while (!done_m) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(pause(random)));
+
+        std::size_t roll = action(random);
+
+        // Drift the fair value a cent at a time; never below a dollar.
+        if (roll < 10) {
+            std::size_t fair = fair_m;
+
+            fair_m = coin(random) ? fair + 1 : std::max<std::size_t>(fair - 1, 100);
+        }
+
+        try {
+            if (roll < 30 && !open.empty()) {
+                std::size_t id = open.front();
+
+                open.pop_front();
+
+                exchange_m.cancel(id);
+            } else if (roll < 35) {
+                // Take liquidity: cross the spread and don't stay.
+                bool        buy = coin(random);
+                std::size_t fair = fair_m;
+
+                exchange_m.submit(account,
+                                  buy ? stock::direction_t::buy : stock::direction_t::sell,
+                                  stock::order_type_t::ioc,
+                                  buy ? fair + 50 : fair - 50,
+                                  size(random));
+            } else {
+                bool        buy = coin(random);
+                std::size_t fair = fair_m;
+                std::size_t price = buy ? fair - offset(random) : fair + offset(random);
+                auto        order = exchange_m.submit(account,
+                                                      buy ? stock::direction_t::buy : stock::direction_t::sell,
+                                                      stock::order_type_t::limit,
+                                                      price,
+                                                      size(random));
+
+                if (order.second.open_m)
+                    open.push_back(stock::order_key_id(order.first));
+
+                if (open.size() > max_open_k) {
+                    std::size_t id = open.front();
+
+                    open.pop_front();
+
+                    exchange_m.cancel(id);
+                }
+            }
+        } catch (...) {
+            // A bot never takes the exchange down with it.
+        }
+    }
+}
+
+/******************************************************************************/
+
+} // namespace mock
+
+/******************************************************************************/
@@ -0,0 +1,62 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef bots_hpp__
+#define bots_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/******************************************************************************/
+
+namespace mock {
+
+/******************************************************************************/
+
+struct exchange_t;
+
+/******************************************************************************/
+// Background traders for the mock exchange. Each bot quotes around a shared,
+// randomly walking fair value, cancels its stale quotes, and now and then
+// crosses the spread, so the book always has depth and the tickertape always
+// has something to say. Bots trade straight into the exchange, not over HTTP.
+
+struct bots_t {
+    // Seeded, so a given seed replays the same order flow (modulo thread
+    // scheduling.)
+    bots_t(exchange_t& exchange, std::size_t count, std::uint64_t seed);
+
+    ~bots_t();
+
+private:
+    bots_t(const bots_t&) = delete;
+    bots_t(bots_t&&) = delete;
+    bots_t& operator=(const bots_t&) = delete;
+    bots_t& operator=(bots_t&&) = delete;
+
+    void trade(std::size_t bot, std::uint64_t seed);
+
+    exchange_t&              exchange_m;
+    std::atomic<bool>        done_m{false};
+    std::atomic<std::size_t> fair_m{5000}; // cents
+    std::vector<std::thread> threads_m;
+};
+
+/******************************************************************************/
+
+} // namespace mock
+
+/******************************************************************************/
+
+#endif // bots_hpp__
+
+/******************************************************************************/
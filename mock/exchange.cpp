@@ -0,0 +1,734 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// boost and websocketpp ahead of the identity header: asio has its own
+// throw_error, which error.hpp's macro would otherwise clobber.
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+
+// identity
+#include "exchange.hpp"
+
+// stdc++
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// application
+#include "error.hpp"
+#include "histogram.hpp"
+#include "json.hpp"
+#include "matching.hpp"
+#include "timestamp.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+namespace ws = websocketpp;
+
+typedef ws::server<ws::config::asio> server_t;
+typedef server_t::message_ptr        message_ptr;
+typedef std::vector<std::string>     path_t;
+
+typedef std::mutex                mutex_t;
+typedef std::unique_lock<mutex_t> lock_t;
+
+/******************************************************************************/
+
+const std::size_t seconds_per_day_k = 5;
+const std::size_t end_of_the_world_k = 1000;
+
+/******************************************************************************/
+
+std::int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/******************************************************************************/
+// Splits the path part of a resource (dropping any query) on '/'.
+
+path_t split(const std::string& resource) {
+    path_t      result;
+    std::string component;
+
+    for (char c : resource.substr(0, resource.find('?'))) {
+        if (c != '/') {
+            component += c;
+        } else if (!component.empty()) {
+            result.push_back(std::move(component));
+
+            component.clear();
+        }
+    }
+
+    if (!component.empty())
+        result.push_back(std::move(component));
+
+    return result;
+}
+
+/******************************************************************************/
+
+bool matches(const path_t& path, std::initializer_list<const char*> pattern) {
+    if (path.size() != pattern.size())
+        return false;
+
+    std::size_t i(0);
+
+    for (const char* component : pattern) {
+        if (*component != ':' && path[i] != component)
+            return false;
+
+        ++i;
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+
+stock::order_type_t order_type_cast(const std::string& type) {
+    if (type == "limit") {
+        return stock::order_type_t::limit;
+    } else if (type == "market") {
+        return stock::order_type_t::market;
+    } else if (type == "fill-or-kill") {
+        return stock::order_type_t::fok;
+    } else if (type == "immediate-or-cancel") {
+        return stock::order_type_t::ioc;
+    }
+
+    throw_error("unknown order type: " + type);
+}
+
+/******************************************************************************/
+
+const char* order_type_cast(stock::order_type_t type) {
+    switch (type) {
+        case stock::order_type_t::limit: return "limit";
+        case stock::order_type_t::market: return "market";
+        case stock::order_type_t::fok: return "fill-or-kill";
+        case stock::order_type_t::ioc: return "immediate-or-cancel";
+        default: throw_error("unknown order type");
+    }
+}
+
+/******************************************************************************/
+
+stock::direction_t direction_cast(const std::string& direction) {
+    if (direction == "buy") {
+        return stock::direction_t::buy;
+    } else if (direction == "sell") {
+        return stock::direction_t::sell;
+    }
+
+    throw_error("unknown direction: " + direction);
+}
+
+/******************************************************************************/
+
+const char* direction_cast(stock::direction_t direction) {
+    return direction == stock::direction_t::buy ? "buy" : "sell";
+}
+
+/******************************************************************************/
+
+json_t ok(json_t::object object) {
+    object["ok"] = true;
+
+    return json_t(std::move(object));
+}
+
+/******************************************************************************/
+
+json_t to_json(const stock::fill_t& fill) {
+    return json_t::object{
+        { "price", static_cast<int>(fill.price_m) },
+        { "qty", static_cast<int>(fill.quantity_m) },
+        { "ts", stock::format_timestamp(fill.ts_m) }
+    };
+}
+
+/******************************************************************************/
+
+json_t to_json(const stock::order_book_t::value_type& value) {
+    const stock::order_t& order = value.second;
+    json_t::array         fills;
+
+    for (const auto& fill : order.fills_m) {
+        fills.push_back(to_json(fill));
+    }
+
+    return ok(json_t::object{
+        { "symbol", stock::symbol_name(order.symbol_m) },
+        { "venue", stock::symbol_name(stock::order_key_venue(value.first)) },
+        { "direction", direction_cast(order.direction_m) },
+        { "originalQty", static_cast<int>(order.original_quantity_m) },
+        { "qty", static_cast<int>(order.quantity_m) },
+        { "price", static_cast<int>(order.price_m) },
+        { "orderType", order_type_cast(order.type_m) },
+        { "id", static_cast<int>(stock::order_key_id(value.first)) },
+        { "account", stock::symbol_name(order.account_m) },
+        { "ts", stock::format_timestamp(order.timestamp_m) },
+        { "fills", std::move(fills) },
+        { "totalFilled", static_cast<int>(order.total_filled_m) },
+        { "open", order.open_m }
+    });
+}
+
+/******************************************************************************/
+
+json_t to_json(const stock::ticker_t& quote, const std::string& venue, const std::string& symbol) {
+    json_t::object result{
+        { "symbol", symbol },
+        { "venue", venue },
+        { "bidSize", static_cast<int>(quote.bid_size_m) },
+        { "askSize", static_cast<int>(quote.ask_size_m) },
+        { "bidDepth", static_cast<int>(quote.bid_depth_m) },
+        { "askDepth", static_cast<int>(quote.ask_depth_m) },
+        { "quoteTime", stock::format_timestamp(quote.quote_time_m) }
+    };
+
+    // Like the venue, prices are left out when there is nothing there.
+    if (quote.bid_m)
+        result["bid"] = static_cast<int>(quote.bid_m);
+
+    if (quote.ask_m)
+        result["ask"] = static_cast<int>(quote.ask_m);
+
+    if (quote.last_size_m) {
+        result["last"] = static_cast<int>(quote.last_m);
+        result["lastSize"] = static_cast<int>(quote.last_size_m);
+        result["lastTrade"] = stock::format_timestamp(quote.last_trade_m);
+    }
+
+    return ok(std::move(result));
+}
+
+/******************************************************************************/
+
+json_t to_json(std::size_t id, const stock::execution_t& execution) {
+    stock::order_key_t key = stock::make_order_key(execution.venue_m, id);
+
+    return ok(json_t::object{
+        { "account", stock::symbol_name(execution.account_m) },
+        { "venue", stock::symbol_name(execution.venue_m) },
+        { "symbol", stock::symbol_name(execution.symbol_m) },
+        { "order", to_json(stock::order_book_t::value_type{key, execution.order_m}) },
+        { "standingId", static_cast<int>(execution.standing_id_m) },
+        { "incomingId", static_cast<int>(execution.incoming_id_m) },
+        { "price", static_cast<int>(execution.price_m) },
+        { "filled", static_cast<int>(execution.filled_m) },
+        { "filledAt", stock::format_timestamp(execution.filled_at_m) },
+        { "standingComplete", execution.standing_complete_m },
+        { "incomingComplete", execution.incoming_complete_m }
+    });
+}
+
+/******************************************************************************/
+
+json_t to_json(const stock::levels_t& levels, bool is_buy) {
+    json_t::array result;
+
+    for (const auto& level : levels) {
+        result.push_back(json_t::object{
+            { "price", static_cast<int>(level.price_m) },
+            { "qty", static_cast<int>(level.quantity_m) },
+            { "isBuy", is_buy }
+        });
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+json_t failure(std::string error) {
+    return json_t::object{ { "ok", false }, { "error", std::move(error) } };
+}
+
+/******************************************************************************/
+
+struct instance_t {
+    std::string  account_m;
+    std::string  state_m{"open"};
+    std::int64_t start_m{steady_ns()};
+};
+
+/******************************************************************************/
+// Who is listening on a websocket: an account, and whether it wants the
+// tickertape or its executions.
+
+struct subscription_t {
+    stock::symbol_id_t account_m{0};
+    bool               executions_m{false};
+};
+
+typedef std::map<ws::connection_hdl,
+                 subscription_t,
+                 std::owner_less<ws::connection_hdl>> subscriptions_t;
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace mock {
+
+/******************************************************************************/
+
+struct exchange_t::impl_t {
+    impl_t(std::string venue, std::string symbol) :
+        engine_m(std::move(venue), std::move(symbol)) {
+        server_m.clear_access_channels(ws::log::alevel::all);
+        server_m.clear_error_channels(ws::log::elevel::all);
+
+        server_m.init_asio();
+        server_m.set_reuse_addr(true);
+
+        server_m.set_open_handler([=](ws::connection_hdl hdl) { on_open(hdl); });
+        server_m.set_close_handler([=](ws::connection_hdl hdl) { on_close(hdl); });
+        server_m.set_http_handler([=](ws::connection_hdl hdl) { on_http(hdl); });
+
+        engine_m.handle_execution([=](std::size_t id, const stock::execution_t& execution) {
+            publish(id, execution);
+        });
+    }
+
+    void run(std::uint16_t port, std::size_t threads) {
+        server_m.listen(port);
+        server_m.start_accept();
+
+        std::vector<std::thread> pool;
+
+        for (std::size_t i(1); i < threads; ++i) {
+            pool.emplace_back([=](){ server_m.run(); });
+        }
+
+        server_m.run();
+
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    void stop() {
+        server_m.stop_listening();
+        server_m.stop();
+    }
+
+    stock::order_book_t::value_type submit(const std::string&  account,
+                                           stock::direction_t  direction,
+                                           stock::order_type_t type,
+                                           std::size_t         price,
+                                           std::size_t         quantity) {
+        auto result = engine_m.submit(stock::intern_symbol(account),
+                                      direction,
+                                      type,
+                                      price,
+                                      quantity,
+                                      stock::now_timestamp());
+
+        publish(engine_m.quote());
+
+        return result;
+    }
+
+    stock::order_book_t::value_type cancel(std::size_t id) {
+        auto result = engine_m.cancel(id, stock::now_timestamp());
+
+        publish(engine_m.quote());
+
+        return result;
+    }
+
+    std::vector<std::string> report() {
+        std::vector<std::string> result;
+        std::size_t              orders = orders_m.exchange(0);
+
+        if (!orders)
+            return result;
+
+        latency_histogram_t::summary_t summary = tick_to_order_m.summary();
+        std::stringstream              stream;
+
+        stream << "MOCK"
+               << " : ORDR : " << orders << "/s"
+               << " : T2O : " << summary.count_m
+               << " : P50 : " << summary.p50_m / 1000 << "us"
+               << " : P99 : " << summary.p99_m / 1000 << "us"
+               << " : MAX : " << summary.max_m / 1000 << "us";
+
+        result.push_back(stream.str());
+
+        return result;
+    }
+
+    stock::matching_engine_t engine_m;
+
+private:
+    void on_open(ws::connection_hdl hdl) {
+        server_t::connection_ptr connection = server_m.get_con_from_hdl(hdl);
+        path_t                   path = split(connection->get_resource());
+        subscription_t           subscription;
+
+        // ob/api/ws/:account/venues/:venue/(tickertape|executions)[/stocks/:stock]
+        if (path.size() < 7 || path[2] != "ws" || path[5] != engine_m.venue()) {
+            connection->close(ws::close::status::policy_violation, "unknown stream");
+
+            return;
+        }
+
+        subscription.account_m = stock::intern_symbol(path[3]);
+        subscription.executions_m = path[6] == "executions";
+
+        lock_t lock{subscriptions_mutex_m};
+
+        subscriptions_m[hdl] = std::move(subscription);
+    }
+
+    void on_close(ws::connection_hdl hdl) {
+        lock_t lock{subscriptions_mutex_m};
+
+        subscriptions_m.erase(hdl);
+    }
+
+    void on_http(ws::connection_hdl hdl) {
+        server_t::connection_ptr connection = server_m.get_con_from_hdl(hdl);
+        json_t                   reply;
+        ws::http::status_code::value status = ws::http::status_code::ok;
+
+        try {
+            reply = route(connection->get_request().get_method(),
+                          split(connection->get_resource()),
+                          connection->get_request_body(),
+                          status);
+        } catch (const std::exception& error) {
+            reply = failure(error.what());
+            status = ws::http::status_code::bad_request;
+        }
+
+        connection->set_status(status);
+        connection->append_header("Content-Type", "application/json");
+        connection->set_body(reply.dump());
+    }
+
+    json_t route(const std::string&            method,
+                 const path_t&                 path,
+                 const std::string&            body,
+                 ws::http::status_code::value& status);
+
+    json_t order(const std::string& body);
+
+    json_t start_level();
+
+    json_t instance(std::size_t id, const std::string& action);
+
+    void publish(const stock::ticker_t& quote) {
+        json_t      tick = json_t::object{
+            { "ok", true },
+            { "quote", to_json(quote, engine_m.venue(), engine_m.symbol()) }
+        };
+        std::string message = tick.dump();
+
+        broadcast(message, [](const subscription_t& subscription) {
+            return !subscription.executions_m;
+        });
+
+        last_tick_m = steady_ns();
+    }
+
+    void publish(std::size_t id, const stock::execution_t& execution) {
+        std::string message = to_json(id, execution).dump();
+
+        broadcast(message, [&](const subscription_t& subscription) {
+            return subscription.executions_m &&
+                   subscription.account_m == execution.account_m;
+        });
+    }
+
+    template <typename Predicate>
+    void broadcast(const std::string& message, Predicate predicate) {
+        std::vector<ws::connection_hdl> targets;
+
+        /* subscription lock scope */ {
+            lock_t lock{subscriptions_mutex_m};
+
+            for (const auto& subscription : subscriptions_m) {
+                if (predicate(subscription.second)) {
+                    targets.push_back(subscription.first);
+                }
+            }
+        }
+
+        for (const auto& hdl : targets) {
+            ws::lib::error_code error;
+
+            server_m.send(hdl, message, ws::frame::opcode::text, error);
+        }
+    }
+
+    server_t                          server_m;
+    subscriptions_t                   subscriptions_m;
+    mutex_t                           subscriptions_mutex_m;
+    std::map<std::size_t, instance_t> instances_m; // by instance id
+    mutex_t                           instances_mutex_m;
+    std::atomic<std::size_t>          orders_m{0}; // from clients, since the last report
+    std::atomic<std::int64_t>         last_tick_m{0}; // steady clock ns
+    latency_histogram_t               tick_to_order_m;
+};
+
+/******************************************************************************/
+
+json_t exchange_t::impl_t::route(const std::string&            method,
+                                 const path_t&                 path,
+                                 const std::string&            body,
+                                 ws::http::status_code::value& status) {
+    const std::string& venue = engine_m.venue();
+    const std::string& symbol = engine_m.symbol();
+
+    if (path.size() >= 2 && path[0] == "gm") {
+        if (method == "POST" && matches(path, { "gm", "levels", ":level" })) {
+            return start_level();
+        } else if (matches(path, { "gm", "instances", ":id" })) {
+            return instance(std::stoul(path[2]), "");
+        } else if (method == "POST" && matches(path, { "gm", "instances", ":id", ":action" })) {
+            return instance(std::stoul(path[2]), path[3]);
+        }
+    } else if (path.size() >= 3 && path[0] == "ob" && path[1] == "api") {
+        if (matches(path, { "ob", "api", "heartbeat" })) {
+            return ok(json_t::object{ { "error", "" } });
+        }
+
+        // Everything else is under venues/:venue
+        if (path.size() < 4 || path[2] != "venues" || path[3] != venue) {
+            status = ws::http::status_code::not_found;
+
+            return failure("No venue exists with the symbol " + (path.size() > 3 ? path[3] : ""));
+        }
+
+        if (matches(path, { "ob", "api", "venues", ":venue", "heartbeat" })) {
+            return ok(json_t::object{ { "venue", venue } });
+        } else if (matches(path, { "ob", "api", "venues", ":venue", "stocks" })) {
+            return ok(json_t::object{
+                { "symbols", json_t::array{ json_t::object{ { "name", symbol },
+                                                            { "symbol", symbol } } } }
+            });
+        } else if (matches(path, { "ob", "api", "venues", ":venue", "accounts", ":account", "orders" }) ||
+                   matches(path, { "ob", "api", "venues", ":venue", "accounts", ":account",
+                                   "stocks", ":stock", "orders" })) {
+            json_t::array orders;
+
+            for (const auto& order : engine_m.orders(stock::intern_symbol(path[5]))) {
+                orders.push_back(to_json(order));
+            }
+
+            return ok(json_t::object{ { "venue", venue }, { "orders", std::move(orders) } });
+        }
+
+        if (path.size() < 6 || path[4] != "stocks" || path[5] != symbol) {
+            status = ws::http::status_code::not_found;
+
+            return failure("No stock exists with the symbol " + (path.size() > 5 ? path[5] : ""));
+        }
+
+        if (method == "GET" && matches(path, { "ob", "api", "venues", ":venue", "stocks", ":stock" })) {
+            stock::levels_t bids;
+            stock::levels_t asks;
+
+            engine_m.levels(bids, asks);
+
+            return ok(json_t::object{
+                { "venue", venue },
+                { "symbol", symbol },
+                { "bids", to_json(bids, true) },
+                { "asks", to_json(asks, false) },
+                { "ts", stock::format_timestamp(stock::now_timestamp()) }
+            });
+        } else if (matches(path, { "ob", "api", "venues", ":venue", "stocks", ":stock", "quote" })) {
+            return to_json(engine_m.quote(), venue, symbol);
+        } else if (method == "POST" && matches(path, { "ob", "api", "venues", ":venue", "stocks", ":stock", "orders" })) {
+            return order(body);
+        } else if (matches(path, { "ob", "api", "venues", ":venue", "stocks", ":stock", "orders", ":id" })) {
+            std::size_t id = std::stoul(path[7]);
+
+            return to_json(method == "DELETE" ? cancel(id) : engine_m.status(id));
+        } else if (method == "POST" && matches(path, { "ob", "api", "venues", ":venue", "stocks", ":stock", "orders", ":id", "cancel" })) {
+            return to_json(cancel(std::stoul(path[7])));
+        }
+    }
+
+    status = ws::http::status_code::not_found;
+
+    return failure("Not found: " + method);
+}
+
+/******************************************************************************/
+
+json_t exchange_t::impl_t::order(const std::string& body) {
+    // Time to this order from the last tick we sent out, before any parsing.
+    std::int64_t received = steady_ns();
+    json_t       json = parse_json(body);
+    int          price = json["price"].int_value();
+    int          quantity = json["qty"].int_value();
+
+    if (json["venue"].string_value() != engine_m.venue())
+        throw_error("Venue mismatch: " + json["venue"].string_value());
+
+    if (json["stock"].string_value() != engine_m.symbol())
+        throw_error("Symbol mismatch: " + json["stock"].string_value());
+
+    if (price < 0 || quantity <= 0)
+        throw_error("Price must be non-negative and quantity positive");
+
+    std::int64_t last_tick = last_tick_m;
+
+    if (last_tick)
+        tick_to_order_m.record(static_cast<std::uint64_t>(received - last_tick));
+
+    ++orders_m;
+
+    return to_json(submit(json["account"].string_value(),
+                          direction_cast(json["direction"].string_value()),
+                          order_type_cast(json["orderType"].string_value()),
+                          price,
+                          quantity));
+}
+
+/******************************************************************************/
+
+json_t exchange_t::impl_t::start_level() {
+    lock_t      lock{instances_mutex_m};
+    std::size_t id = instances_m.size() + 1;
+    instance_t& instance = instances_m[id];
+
+    instance.account_m = "MOCK" + std::to_string(100000 + id);
+
+    return ok(json_t::object{
+        { "account", instance.account_m },
+        { "instanceId", static_cast<int>(id) },
+        { "instructions", json_t::object{
+            { "Instructions", "A mock exchange on localhost. Bots trade " + engine_m.symbol() +
+                              " on " + engine_m.venue() + "; so can you." } } },
+        { "secondsPerTradingDay", static_cast<int>(seconds_per_day_k) },
+        { "tickers", json_t::array{ engine_m.symbol() } },
+        { "venues", json_t::array{ engine_m.venue() } }
+    });
+}
+
+/******************************************************************************/
+
+json_t exchange_t::impl_t::instance(std::size_t id, const std::string& action) {
+    lock_t lock{instances_mutex_m};
+    auto   found = instances_m.find(id);
+
+    if (found == instances_m.end())
+        throw_error("No such instance: " + std::to_string(id));
+
+    instance_t& instance = found->second;
+
+    if (action == "restart") {
+        instance.start_m = steady_ns();
+        instance.state_m = "open";
+    } else if (action == "stop") {
+        instance.state_m = "closed";
+    } else if (action == "resume") {
+        instance.state_m = "open";
+    } else if (!action.empty()) {
+        throw_error("Unknown action: " + action);
+    }
+
+    std::int64_t elapsed = steady_ns() - instance.start_m;
+    std::size_t  day = static_cast<std::size_t>(elapsed / 1000000000 / seconds_per_day_k);
+
+    return ok(json_t::object{
+        { "id", static_cast<int>(id) },
+        { "done", instance.state_m != "open" },
+        { "state", instance.state_m },
+        { "details", json_t::object{
+            { "endOfTheWorldDay", static_cast<int>(end_of_the_world_k) },
+            { "tradingDay", static_cast<int>(day) } } },
+        { "flash", json_t::object{} }
+    });
+}
+
+/******************************************************************************/
+
+exchange_t::exchange_t(std::string venue, std::string symbol) :
+    impl_m(new impl_t(std::move(venue), std::move(symbol))) {
+}
+
+/******************************************************************************/
+
+void exchange_t::run(std::uint16_t port, std::size_t threads) {
+    impl_m->run(port, threads);
+}
+
+/******************************************************************************/
+
+void exchange_t::stop() {
+    impl_m->stop();
+}
+
+/******************************************************************************/
+
+stock::order_book_t::value_type exchange_t::submit(const std::string&  account,
+                                                   stock::direction_t  direction,
+                                                   stock::order_type_t type,
+                                                   std::size_t         price,
+                                                   std::size_t         quantity) {
+    return impl_m->submit(account, direction, type, price, quantity);
+}
+
+/******************************************************************************/
+
+stock::order_book_t::value_type exchange_t::cancel(std::size_t id) {
+    return impl_m->cancel(id);
+}
+
+/******************************************************************************/
+
+stock::ticker_t exchange_t::quote() const {
+    return impl_m->engine_m.quote();
+}
+
+/******************************************************************************/
+
+void exchange_t::add_background_account(std::string account) {
+    impl_m->engine_m.add_background_account(stock::intern_symbol(account));
+}
+
+/******************************************************************************/
+
+const std::string& exchange_t::venue() const {
+    return impl_m->engine_m.venue();
+}
+
+/******************************************************************************/
+
+const std::string& exchange_t::symbol() const {
+    return impl_m->engine_m.symbol();
+}
+
+/******************************************************************************/
+
+std::vector<std::string> exchange_t::report() {
+    return impl_m->report();
+}
+
+/******************************************************************************/
+
+} // namespace mock
+
+/******************************************************************************/
@@ -0,0 +1,84 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+#ifndef exchange_hpp__
+#define exchange_hpp__
+
+/******************************************************************************/
+
+// stdc++
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// application
+#include "stock.hpp"
+
+/******************************************************************************/
+
+namespace mock {
+
+/******************************************************************************/
+// A stand-in for the Stockfighter service on localhost: the order book REST
+// api (/ob/api/...), the game master (/gm/levels, /gm/instances) and the
+// tickertape and executions websockets, all in front of a single-symbol
+// matching engine. Point the client's api_url and gm_url settings at it.
+//
+// There is no TLS, no authentication and one venue; every level start hands
+// out a fresh account on that venue.
+
+struct exchange_t {
+    exchange_t(std::string venue, std::string symbol);
+
+    // Serves on the port until stop() is called. Blocks.
+    void run(std::uint16_t port, std::size_t threads);
+
+    void stop();
+
+    // The order apis the REST handlers use, exposed so bots can trade
+    // without going through HTTP. Both broadcast the resulting quote and
+    // executions.
+    stock::order_book_t::value_type submit(const std::string&  account,
+                                           stock::direction_t  direction,
+                                           stock::order_type_t type,
+                                           std::size_t         price,
+                                           std::size_t         quantity);
+    stock::order_book_t::value_type cancel(std::size_t id);
+
+    stock::ticker_t quote() const;
+
+    // See matching_engine_t::add_background_account.
+    void add_background_account(std::string account);
+
+    const std::string& venue() const;
+    const std::string& symbol() const;
+
+    // One line per second of client (non-bot) traffic: orders per second and
+    // the time from the last tick sent to each client order received.
+    std::vector<std::string> report();
+
+private:
+    exchange_t(const exchange_t&) = delete;
+    exchange_t(exchange_t&&) = delete;
+    exchange_t& operator=(const exchange_t&) = delete;
+    exchange_t& operator=(exchange_t&&) = delete;
+
+    struct impl_t;
+
+    std::shared_ptr<impl_t> impl_m;
+};
+
+/******************************************************************************/
+
+} // namespace mock
+
+/******************************************************************************/
+
+#endif // exchange_hpp__
+
+/******************************************************************************/
@@ -0,0 +1,56 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// stdc++
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// application
+#include "bots.hpp"
+#include "exchange.hpp"
+
+/******************************************************************************/
+
+int main(int argc, char** argv) try {
+    std::uint16_t port = argc > 1 ? std::stoi(argv[1]) : 8080;
+    std::size_t   bots = argc > 2 ? std::stoul(argv[2]) : 4;
+    std::uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 42;
+
+    mock::exchange_t exchange("TESTEX", "FOOBAR");
+    mock::bots_t     traders(exchange, bots, seed);
+
+    std::thread([&](){
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+
+            for (const auto& line : exchange.report()) {
+                std::cout << line << '\n';
+            }
+        }
+    }).detach();
+
+    std::cout << "MOCK : " << exchange.venue()
+              << " : " << exchange.symbol()
+              << " : http://localhost:" << port << "/"
+              << " : " << bots << " bots\n";
+
+    exchange.run(port, 4);
+
+    return 0;
+} catch (const std::exception& error) {
+    std::cerr << "Fatal error : " << error.what() << '\n';
+
+    return 1;
+} catch (...) {
+    std::cerr << "Fatal error : Unknown" << '\n';
+
+    return 1;
+}
+
+/******************************************************************************/
@@ -0,0 +1,431 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "bench.hpp"
+
+// stdc++
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
+
+// application
+#include "decode.hpp"
+#include "json.hpp"
+#include "require.hpp"
+#include "sim.hpp"
+#include "stock.hpp"
+#include "task_queue.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+typedef std::chrono::steady_clock                             clock_t;
+typedef std::function<void (std::size_t, std::ostream&)>      bench_proc_t;
+typedef std::map<std::string, std::pair<bench_proc_t, std::size_t>> bench_map_t;
+
+/******************************************************************************/
+
+// Keeps results alive so the optimizer can't throw the work away.
+volatile std::size_t sink_s{0};
+
+/******************************************************************************/
+
+template <typename F>
+double ns_per_op(std::size_t iterations, F f) {
+    auto start = clock_t::now();
+
+    for (std::size_t i(0); i < iterations; ++i) {
+        f(i);
+    }
+
+    auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - start);
+
+    return static_cast<double>(delta.count()) / iterations;
+}
+
+/******************************************************************************/
+
+void report(std::ostream& out, const char* tag, double baseline, double current) {
+    out << "BNCH : " << tag
+        << " : OLD : " << baseline << "ns"
+        << " : NEW : " << current << "ns"
+        << " : " << (current ? baseline / current : 0) << "x\n";
+}
+
+/******************************************************************************/
+// Order request construction: json_t object + dump() + url concatenation, vs.
+// rendering a pre-serialized stock::order_template_t.
+
+void bench_orders(std::size_t iterations, std::ostream& out) {
+    const std::string account("EXB123456");
+    const std::string venue("TESTEX");
+    const std::string symbol("FOOBAR");
+
+    auto legacy = [&](std::size_t price, std::size_t quantity) {
+        json_t parameters = json_t::object {
+            { "account", account },
+            { "venue", venue },
+            { "stock", symbol },
+            { "price", static_cast<int>(price) },
+            { "qty", static_cast<int>(quantity) },
+            { "direction", "buy" },
+            { "orderType", "limit" }
+        };
+
+        std::string url("https://api.stockfighter.io/ob/api/venues/" +
+                        venue +
+                        "/stocks/" +
+                        symbol +
+                        "/orders");
+
+        return std::make_pair(std::move(url), parameters.dump());
+    };
+
+    stock::order_template_t order_template =
+        stock::make_order_template(account,
+                                   venue,
+                                   symbol,
+                                   stock::direction_t::buy,
+                                   stock::order_type_t::limit);
+    std::string             url("https://api.stockfighter.io/ob/api/venues/" +
+                                venue +
+                                "/stocks/" +
+                                symbol +
+                                "/orders");
+    std::string             body;
+
+    // Both paths have to agree before the timings mean anything.
+    order_template.render(5000, 100, body);
+
+    require(parse_json(body) == parse_json(legacy(5000, 100).second));
+
+    double baseline = ns_per_op(iterations, [&](std::size_t i) {
+        auto request = legacy(5000 + i % 100, 1 + i % 50);
+
+        sink_s += request.first.size() + request.second.size();
+    });
+
+    double current = ns_per_op(iterations, [&](std::size_t i) {
+        order_template.render(5000 + i % 100, 1 + i % 50, body);
+
+        sink_s += url.size() + body.size();
+    });
+
+    report(out, "ORDR", baseline, current);
+}
+
+/******************************************************************************/
+// Tickertape frames: parse_json + field lookups, vs. decode_tick (structural
+// index + on-demand fields) into a reused ticker. The frames are as the venue sent them, including the ones with a
+// side (or the last trade) missing.
+
+const char* const tick_frames_k[] = {
+    R"({"ok":true,"quote":{"symbol":"FOOBAR","venue":"TESTEX","bid":5100,"ask":5125,"bidSize":392,"askSize":711,"bidDepth":2748,"askDepth":2237,"last":5125,"lastSize":52,"lastTrade":"2015-12-05T21:36:30.196410227Z","quoteTime":"2015-12-05T21:36:30.196411541Z"}})",
+    R"({"ok":true,"quote":{"symbol":"FOOBAR","venue":"TESTEX","bid":5098,"ask":5125,"bidSize":15,"askSize":711,"bidDepth":2371,"askDepth":2237,"last":5100,"lastSize":377,"lastTrade":"2015-12-05T21:36:30.241975623Z","quoteTime":"2015-12-05T21:36:30.241976913Z"}})",
+    R"({"ok":true,"quote":{"symbol":"FOOBAR","venue":"TESTEX","ask":5125,"askSize":711,"bidDepth":0,"askDepth":2237,"last":5098,"lastSize":15,"lastTrade":"2015-12-05T21:36:30.303181052Z","quoteTime":"2015-12-05T21:36:30.303182251Z"}})",
+    R"({"ok":true,"quote":{"symbol":"FOOBAR","venue":"TESTEX","bid":5060,"bidSize":40,"bidDepth":40,"askDepth":0,"last":5125,"lastSize":711,"lastTrade":"2015-12-05T21:36:30.351072964Z","quoteTime":"2015-12-05T21:36:30.351074110Z"}})",
+    R"({"ok":true,"quote":{"symbol":"FOOBAR","venue":"TESTEX","bid":5060,"ask":5190,"bidSize":40,"askSize":100,"bidDepth":40,"askDepth":100,"quoteTime":"2015-12-05T21:36:30.402218533Z"}})"
+};
+
+const std::size_t tick_frame_count_k = sizeof(tick_frames_k) / sizeof(tick_frames_k[0]);
+
+bool same_ticker(const stock::ticker_t& x, const stock::ticker_t& y) {
+    return x.bid_m == y.bid_m &&
+           x.bid_size_m == y.bid_size_m &&
+           x.bid_depth_m == y.bid_depth_m &&
+           x.ask_m == y.ask_m &&
+           x.ask_size_m == y.ask_size_m &&
+           x.ask_depth_m == y.ask_depth_m &&
+           x.last_m == y.last_m &&
+           x.last_size_m == y.last_size_m &&
+           x.last_trade_m == y.last_trade_m &&
+           x.quote_time_m == y.quote_time_m;
+}
+
+void bench_ticks(std::size_t iterations, std::ostream& out) {
+    std::vector<std::string> frames(std::begin(tick_frames_k), std::end(tick_frames_k));
+    stock::ticker_t          ticker;
+
+    // Both paths have to agree before the timings mean anything.
+    for (const auto& frame : frames) {
+        require(stock::decode_tick(frame, ticker));
+        require(same_ticker(ticker, stock::make_ticker(parse_json(frame))));
+    }
+
+    require(!stock::decode_tick(std::string(R"({"ok":false,"error":"Not found"})"), ticker));
+
+    double baseline = ns_per_op(iterations, [&](std::size_t i) {
+        stock::ticker_t legacy = stock::make_ticker(parse_json(frames[i % tick_frame_count_k]));
+
+        sink_s += legacy.bid_m + static_cast<std::size_t>(legacy.quote_time_m);
+    });
+
+    double current = ns_per_op(iterations, [&](std::size_t i) {
+        stock::decode_tick(frames[i % tick_frame_count_k], ticker);
+
+        sink_s += ticker.bid_m + static_cast<std::size_t>(ticker.quote_time_m);
+    });
+
+    report(out, "TICK", baseline, current);
+
+    out << "BNCH : TICK : KRNL : " << json_index_t::kernel() << "\n";
+}
+
+/******************************************************************************/
+// Executions frames: parse_json + make_order/make_execution, vs.
+// decode_execution into a reused execution (whose fills are reused too.)
+
+const char* const execution_frames_k[] = {
+    R"({"ok":true,"account":"EXB123456","venue":"TESTEX","symbol":"FOOBAR","order":{"ok":true,"symbol":"FOOBAR","venue":"TESTEX","direction":"buy","originalQty":100,"qty":60,"price":5100,"orderType":"limit","id":1017,"account":"EXB123456","ts":"2015-12-05T21:36:30.195032117Z","fills":[{"price":5100,"qty":40,"ts":"2015-12-05T21:36:30.196410227Z"}],"totalFilled":40,"open":true},"standingId":1017,"incomingId":1018,"price":5100,"filled":40,"filledAt":"2015-12-05T21:36:30.196410227Z","standingComplete":false,"incomingComplete":true})",
+    R"({"ok":true,"account":"EXB123456","venue":"TESTEX","symbol":"FOOBAR","order":{"ok":true,"symbol":"FOOBAR","venue":"TESTEX","direction":"buy","originalQty":100,"qty":0,"price":5100,"orderType":"limit","id":1017,"account":"EXB123456","ts":"2015-12-05T21:36:30.195032117Z","fills":[{"price":5100,"qty":40,"ts":"2015-12-05T21:36:30.196410227Z"},{"price":5100,"qty":35,"ts":"2015-12-05T21:36:30.241975623Z"},{"price":5100,"qty":25,"ts":"2015-12-05T21:36:30.303181052Z"}],"totalFilled":100,"open":false},"standingId":1017,"incomingId":1021,"price":5100,"filled":25,"filledAt":"2015-12-05T21:36:30.303181052Z","standingComplete":true,"incomingComplete":false})",
+    R"({"ok":true,"account":"EXB123456","venue":"TESTEX","symbol":"FOOBAR","order":{"ok":true,"symbol":"FOOBAR","venue":"TESTEX","direction":"sell","originalQty":50,"qty":0,"price":5060,"orderType":"immediate-or-cancel","id":1024,"account":"EXB123456","ts":"2015-12-05T21:36:30.351070001Z","fills":[{"price":5060,"qty":40,"ts":"2015-12-05T21:36:30.351072964Z"}],"totalFilled":40,"open":false},"standingId":1022,"incomingId":1024,"price":5060,"filled":40,"filledAt":"2015-12-05T21:36:30.351072964Z","standingComplete":true,"incomingComplete":true})"
+};
+
+const std::size_t execution_frame_count_k = sizeof(execution_frames_k) / sizeof(execution_frames_k[0]);
+
+bool same_order(const stock::order_t& x, const stock::order_t& y) {
+    if (x.fills_m.size() != y.fills_m.size())
+        return false;
+
+    for (std::size_t i(0); i < x.fills_m.size(); ++i) {
+        if (x.fills_m[i].price_m != y.fills_m[i].price_m ||
+            x.fills_m[i].quantity_m != y.fills_m[i].quantity_m ||
+            x.fills_m[i].ts_m != y.fills_m[i].ts_m)
+            return false;
+    }
+
+    return x.open_m == y.open_m &&
+           x.account_m == y.account_m &&
+           x.symbol_m == y.symbol_m &&
+           x.direction_m == y.direction_m &&
+           x.type_m == y.type_m &&
+           x.original_quantity_m == y.original_quantity_m &&
+           x.price_m == y.price_m &&
+           x.quantity_m == y.quantity_m &&
+           x.total_filled_m == y.total_filled_m &&
+           x.timestamp_m == y.timestamp_m;
+}
+
+bool same_execution(const stock::execution_t& x, const stock::execution_t& y) {
+    return same_order(x.order_m, y.order_m) &&
+           x.account_m == y.account_m &&
+           x.venue_m == y.venue_m &&
+           x.symbol_m == y.symbol_m &&
+           x.standing_id_m == y.standing_id_m &&
+           x.incoming_id_m == y.incoming_id_m &&
+           x.price_m == y.price_m &&
+           x.filled_m == y.filled_m &&
+           x.filled_at_m == y.filled_at_m &&
+           x.standing_complete_m == y.standing_complete_m &&
+           x.incoming_complete_m == y.incoming_complete_m;
+}
+
+void bench_executions(std::size_t iterations, std::ostream& out) {
+    std::vector<std::string> frames(std::begin(execution_frames_k), std::end(execution_frames_k));
+    stock::order_key_t       key;
+    stock::execution_t       execution;
+
+    // Both paths have to agree before the timings mean anything. (Decoding
+    // the long frame first leaves spare fills for the short ones to reuse.)
+    for (std::size_t i(frames.size()); i != 0; --i) {
+        const std::string& frame = frames[i - 1];
+        json_t             json = parse_json(frame);
+
+        require(stock::decode_execution(frame, key, execution));
+        require(key == stock::make_order(json["order"]).first);
+        require(same_execution(execution, stock::make_execution(json)));
+    }
+
+    double baseline = ns_per_op(iterations, [&](std::size_t i) {
+        json_t             json = parse_json(frames[i % execution_frame_count_k]);
+        stock::order_key_t legacy_key = stock::make_order(json["order"]).first;
+        stock::execution_t legacy = stock::make_execution(json);
+
+        sink_s += stock::order_key_id(legacy_key) + legacy.order_m.fills_m.size();
+    });
+
+    double current = ns_per_op(iterations, [&](std::size_t i) {
+        stock::decode_execution(frames[i % execution_frame_count_k], key, execution);
+
+        sink_s += stock::order_key_id(key) + execution.order_m.fills_m.size();
+    });
+
+    report(out, "EXEC", baseline, current);
+}
+
+/******************************************************************************/
+// Tasks: a closure copied into a heap-allocated std::function on a
+// heap-allocated node (as task_queue_t used to), vs. moved into a task_t and
+// on into another (as into and out of an injection queue cell.) What each
+// allocates is counted by stockfighter_allocations, which has to replace the
+// global allocator to do it and so is kept out of this binary.
+
+struct closure_t {
+    void operator()() const {
+        ran_m->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::size_t>* ran_m;
+    std::size_t               payload_m[2]; // for the rest of a typical closure's captures
+};
+
+void bench_tasks(std::size_t iterations, std::ostream& out) {
+    typedef std::function<void ()> legacy_t;
+    typedef task_queue_t::task_t   task_t;
+
+    std::atomic<std::size_t> ran{0};
+
+    static_assert(sizeof(closure_t) <= task_t::capacity_k, "closure_t should fit a task_t");
+
+    require(task_t(closure_t{&ran, { 0, 0 }}).inline_storage());
+
+    double baseline = ns_per_op(iterations, [&](std::size_t i) {
+        std::unique_ptr<legacy_t> task(new legacy_t(closure_t{&ran, { i, i }}));
+
+        (*task)();
+    });
+
+    double current = ns_per_op(iterations, [&](std::size_t i) {
+        task_t task(closure_t{&ran, { i, i }});
+        task_t taken(std::move(task));
+
+        taken();
+    });
+
+    report(out, "TASK", baseline, current);
+}
+
+/******************************************************************************/
+// The simulator, run twice from the same seed with an engine trading against
+// it from the tick handler: both runs must make the same fills and end up
+// holding the same. Then how many events a second it gets through.
+
+struct sim_run_t {
+    std::vector<std::size_t> fills_m; // order, price, quantity, time; per fill
+    stock::holdings_t        holdings_m;
+    double                   seconds_m{0};
+};
+
+sim_run_t run_sim(std::uint64_t seed, std::size_t events) {
+    stock::sim_exchange_t sim(seed);
+    stock::engine_t       engine;
+    sim_run_t             result;
+    std::size_t           ticks{0};
+
+    engine.simulate(sim);
+
+    // Every so often, take the touch or join it, leaning against the position.
+    sim.handle_tick([&](const stock::ticker_t& ticker) {
+        if (++ticks % 16 || !ticker.bid_m || !ticker.ask_m)
+            return;
+
+        bool                take = ticks % 64 == 0;
+        stock::order_type_t type = take ? stock::order_type_t::ioc : stock::order_type_t::limit;
+
+        if (engine.holdings().position_m > 0)
+            engine.sell(take ? ticker.bid_m : ticker.ask_m, 10, type);
+        else
+            engine.buy(take ? ticker.ask_m : ticker.bid_m, 10, type);
+    });
+
+    sim.handle_execution([&](stock::order_key_t        key,
+                             const stock::execution_t& execution) {
+        engine.update_position(key, execution);
+
+        result.fills_m.push_back(stock::order_key_id(key));
+        result.fills_m.push_back(execution.price_m);
+        result.fills_m.push_back(execution.filled_m);
+        result.fills_m.push_back(static_cast<std::size_t>(execution.filled_at_m));
+    });
+
+    auto start = clock_t::now();
+
+    sim.run(events);
+
+    result.seconds_m = std::chrono::duration<double>(clock_t::now() - start).count();
+    result.holdings_m = engine.holdings();
+
+    return result;
+}
+
+void bench_sim(std::size_t iterations, std::ostream& out) {
+    const std::uint64_t seed(42);
+
+    sim_run_t first = run_sim(seed, iterations);
+    sim_run_t second = run_sim(seed, iterations);
+
+    out << "BNCH : SIMU : FILL : " << first.fills_m.size() / 4
+        << " : POS : " << first.holdings_m.position_m
+        << " : " << static_cast<std::size_t>(iterations / first.seconds_m) << "/s"
+        << " : " << static_cast<std::size_t>(iterations / second.seconds_m) << "/s\n";
+
+    require(!first.fills_m.empty());
+    require(first.fills_m == second.fills_m);
+    require(first.holdings_m == second.holdings_m);
+}
+
+/******************************************************************************/
+
+const bench_map_t& benches() {
+    static const bench_map_t benches_s{
+        { "executions", { &bench_executions, 1000000 } },
+        { "orders", { &bench_orders, 1000000 } },
+        { "sim", { &bench_sim, 1000000 } },
+        { "tasks", { &bench_tasks, 1000000 } },
+        { "ticks", { &bench_ticks, 1000000 } }
+    };
+
+    return benches_s;
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace bench {
+
+/******************************************************************************/
+
+bool run(const std::string& name, std::size_t iterations, std::ostream& out) {
+    auto found = benches().find(name);
+
+    if (found == benches().end())
+        return false;
+
+    found->second.first(iterations ? iterations : found->second.second, out);
+
+    return true;
+}
+
+/******************************************************************************/
+
+std::string list() {
+    std::string result;
+
+    for (const auto& bench : benches()) {
+        result += (result.empty() ? "" : " ") + bench.first;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+} // namespace bench
+
+/******************************************************************************/
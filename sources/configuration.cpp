@@ -56,6 +56,19 @@ json_t slurp_json(const boost::filesystem::path& path) {
     return json_raw.empty() ? json_t() : parse_json(json_raw);
 }
 
+/******************************************************************************/
+// Keeps the default unless the settings name a url; either way it ends in '/'.
+
+void read_url(const json_t& json, std::string& url) {
+    if (!json.is_string() || json.string_value().empty())
+        return;
+
+    url = json.string_value();
+
+    if (url.back() != '/')
+        url += '/';
+}
+
 /******************************************************************************/
 
 typedef std::mutex                   mutex_t;
@@ -133,6 +146,21 @@ bool init(const std::string& binary_path_str,
     json_t json = slurp_json(settings_path);
 
     settings.api_key_m = json["api_key"].string_value();
+    settings.http2_m = json["http2"].bool_value();
+
+    read_url(json["api_url"], settings.api_url_m);
+    read_url(json["gm_url"], settings.gm_url_m);
+
+    const json_t& simulation = json["simulation"];
+
+    settings.sim_seed_m = static_cast<std::uint64_t>(simulation["seed"].number_value());
+    settings.sim_events_m = static_cast<std::size_t>(simulation["events"].number_value());
+
+    const json_t& workers = json["workers"];
+
+    settings.idle_spin_m = static_cast<std::size_t>(workers["spin"].number_value());
+    settings.idle_yield_m = static_cast<std::size_t>(workers["yield"].number_value());
+    settings.hot_workers_m = static_cast<std::size_t>(workers["hot"].number_value());
 
     prefs().init();
 
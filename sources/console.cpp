@@ -9,6 +9,8 @@
 #include "console.hpp"
 
 // application
+#include "bench.hpp"
+#include "curl.hpp"
 #include "error.hpp"
 #include "stock.hpp"
 #include "str.hpp"
@@ -28,6 +30,8 @@ void handle_line(std::string      line,
 
     if (command == "q") {
         std::cout << game.quote() << '\n';
+    } else if (command == "d") {
+        std::cout << game.depth() << '\n';
     } else if (command == "h") {
         stock::holdings_t holdings = game.holdings();
 
@@ -35,6 +39,15 @@ void handle_line(std::string      line,
                   << " : POS : " << holdings.position_m
                   << " : NAV : " << str::to_money(holdings.nav_m)
                   << '\n';
+    } else if (command == "n") {
+        curl_pool_stats_t stats = stock::connection_stats();
+
+        std::cout << " : POOL : HIT : " << stats.hits_m
+                  << " : MISS : " << stats.misses_m
+                  << " : IDLE : " << stats.idle_m
+                  << " : CONN : REUSE : " << stats.reused_m
+                  << " : NEW : " << stats.connects_m
+                  << '\n';
     } else if (command == "b") {
         std::size_t qty = std::stoul(str::pop_front(line));
         std::size_t price = std::stoul(str::pop_front(line));
@@ -45,6 +58,31 @@ void handle_line(std::string      line,
         std::size_t price = std::stoul(str::pop_front(line));
 
         game.sell(qty, price);
+    } else if (command == "l") {
+        for (const auto& line : stock::latency_report()) {
+            std::cout << line << '\n';
+        }
+    } else if (command == "r") {
+        for (const auto& line : stock::rate_limit_report()) {
+            std::cout << line << '\n';
+        }
+    } else if (command == "t") {
+        for (const auto& line : queue.lane_report()) {
+            std::cout << line << '\n';
+        }
+
+        for (const auto& line : queue.wake_report()) {
+            std::cout << line << '\n';
+        }
+    } else if (command == "x") {
+        std::cout << game.cancel_all() << '\n';
+    } else if (command == "bench") {
+        std::string name = str::pop_front(line);
+        std::string count = str::pop_front(line);
+
+        if (!bench::run(name, count.empty() ? 0 : std::stoul(count), std::cout)) {
+            std::cout << "Benchmarks : " << bench::list() << '\n';
+        }
     } else if (command == "quit") {
         std::cout << "Bye!\n";
 
@@ -86,12 +124,19 @@ void console(log_t&           log,
 
             std::getline(std::cin, line);
 
+            // Pulling our orders shouldn't wait behind ticks and depth polls.
+            std::string command(line);
+            priority_t  priority = str::pop_front(command) == "x" ?
+                                       priority_t::critical :
+                                       priority_t::normal;
+
             queue.push(std::bind(handle_line,
                                  std::move(line), // moving into a block fixed in c++14
                                  std::ref(log),
                                  std::ref(recur),
                                  std::ref(queue),
-                                 std::ref(game)));
+                                 std::ref(game)),
+                       priority);
         } catch (const std::exception& error) {
             std::cout << "Error : " << error.what() << '\n';
         } catch (...) {
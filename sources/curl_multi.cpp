@@ -0,0 +1,366 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// boost (ahead of the identity header, whose throw_error macro collides with
+// boost::asio::detail::throw_error)
+#include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+// identity
+#include "curl_multi.hpp"
+
+// stdc++
+#include <atomic>
+#include <iostream>
+#include <map>
+
+// application
+#include "error.hpp"
+#include "service.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+typedef boost::asio::posix::stream_descriptor descriptor_t;
+typedef boost::system::error_code             error_code_t;
+
+/******************************************************************************/
+
+void multi_assert(CURLMcode code) {
+    if (code == CURLM_OK)
+        return;
+
+    throw_error(std::string("CURLM : ") + curl_multi_strerror(code));
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+// Everything in here other than submit() runs on the io thread, so none of it
+// needs a lock.
+
+struct curl_multi_t::impl_t {
+    struct transfer_t {
+        curl_pool_t::handle_t curl_m;
+        completion_t          completion_m;
+    };
+
+    struct socket_t {
+        explicit socket_t(curl_socket_t fd) :
+            descriptor_m(service::io(), fd) {
+        }
+
+        descriptor_t descriptor_m;
+        int          what_m{CURL_POLL_NONE}; // what curl wants to hear about
+        bool         reading_m{false};       // read wait in flight
+        bool         writing_m{false};       // write wait in flight
+        bool         open_m{true};           // false once curl is done with it
+    };
+
+    typedef std::shared_ptr<transfer_t>            shared_transfer_t;
+    typedef std::shared_ptr<socket_t>              shared_socket_t;
+    typedef std::map<CURL*, shared_transfer_t>     transfer_map_t;
+    typedef std::map<curl_socket_t, shared_socket_t> socket_map_t;
+
+    impl_t() :
+        multi_m(curl_multi_init()),
+        timer_m(service::io()) {
+        require_multi();
+
+        multi_assert(curl_multi_setopt(multi_m, CURLMOPT_SOCKETFUNCTION, &impl_t::socket_callback));
+        multi_assert(curl_multi_setopt(multi_m, CURLMOPT_SOCKETDATA, this));
+        multi_assert(curl_multi_setopt(multi_m, CURLMOPT_TIMERFUNCTION, &impl_t::timer_callback));
+        multi_assert(curl_multi_setopt(multi_m, CURLMOPT_TIMERDATA, this));
+
+        service::start();
+    }
+
+    ~impl_t() {
+        for (const auto& transfer : transfers_m) {
+            curl_multi_remove_handle(multi_m, transfer.first);
+        }
+
+        for (const auto& socket : sockets_m) {
+            close(*socket.second);
+        }
+
+        curl_multi_cleanup(multi_m);
+    }
+
+    void submit(std::chrono::steady_clock::duration delay,
+                curl_pool_t::handle_t               curl,
+                completion_t                        completion) {
+        shared_transfer_t transfer(new transfer_t{std::move(curl), std::move(completion)});
+
+        ++in_flight_m;
+
+        if (delay <= std::chrono::steady_clock::duration::zero()) {
+            service::io().post([=]() {
+                add(transfer);
+            });
+
+            return;
+        }
+
+        std::shared_ptr<boost::asio::steady_timer> timer(new boost::asio::steady_timer(service::io()));
+
+        timer->expires_from_now(delay);
+
+        // The handler holds the only reference to the timer, keeping it alive
+        // until it fires.
+        timer->async_wait([=](const error_code_t&) {
+            timer.get();
+
+            add(transfer);
+        });
+    }
+
+    std::size_t in_flight() const {
+        return in_flight_m;
+    }
+
+    void set_multiplexing(bool multiplex) {
+        long mode = multiplex ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING;
+
+        multi_assert(curl_multi_setopt(multi_m, CURLMOPT_PIPELINING, mode));
+    }
+
+private:
+    impl_t(const impl_t&) = delete;
+    impl_t(impl_t&&) = delete;
+    impl_t& operator=(const impl_t&) = delete;
+    impl_t& operator=(impl_t&&) = delete;
+
+    void require_multi() {
+        if (!multi_m)
+            throw_error("CURLM : could not create multi handle");
+    }
+
+    static int socket_callback(CURL*,
+                               curl_socket_t fd,
+                               int           what,
+                               void*         userp,
+                               void*) {
+        static_cast<impl_t*>(userp)->on_socket(fd, what);
+
+        return 0;
+    }
+
+    static int timer_callback(CURLM*, long timeout_ms, void* userp) {
+        static_cast<impl_t*>(userp)->on_timer(timeout_ms);
+
+        return 0;
+    }
+
+    void add(const shared_transfer_t& transfer) {
+        CURL* easy = transfer->curl_m->native_handle();
+
+        try {
+            transfer->curl_m->prepare();
+
+            multi_assert(curl_multi_add_handle(multi_m, easy));
+        } catch (...) {
+            complete(transfer, std::current_exception());
+
+            return;
+        }
+
+        transfers_m[easy] = transfer;
+    }
+
+    void on_socket(curl_socket_t fd, int what) {
+        if (what == CURL_POLL_REMOVE) {
+            auto found = sockets_m.find(fd);
+
+            if (found == sockets_m.end())
+                return;
+
+            close(*found->second);
+
+            sockets_m.erase(found);
+
+            return;
+        }
+
+        shared_socket_t& socket = sockets_m[fd];
+
+        if (!socket) {
+            socket.reset(new socket_t(fd));
+        }
+
+        socket->what_m = what;
+
+        arm(socket);
+    }
+
+    void on_timer(long timeout_ms) {
+        if (timeout_ms < 0) {
+            timer_m.cancel();
+
+            return;
+        }
+
+        timer_m.expires_from_now(std::chrono::milliseconds(timeout_ms));
+
+        timer_m.async_wait([=](const error_code_t& error) {
+            if (error)
+                return;
+
+            action(CURL_SOCKET_TIMEOUT, 0);
+        });
+    }
+
+    // Asks asio to tell us when the socket is ready for whatever curl is
+    // currently interested in, if we're not already waiting on it.
+    void arm(const shared_socket_t& socket) {
+        if ((socket->what_m & CURL_POLL_IN) && !socket->reading_m) {
+            socket->reading_m = true;
+
+            socket->descriptor_m.async_read_some(boost::asio::null_buffers(),
+                                                 [=](const error_code_t& error, std::size_t) {
+                socket->reading_m = false;
+
+                ready(socket, error, CURL_CSELECT_IN);
+            });
+        }
+
+        if ((socket->what_m & CURL_POLL_OUT) && !socket->writing_m) {
+            socket->writing_m = true;
+
+            socket->descriptor_m.async_write_some(boost::asio::null_buffers(),
+                                                  [=](const error_code_t& error, std::size_t) {
+                socket->writing_m = false;
+
+                ready(socket, error, CURL_CSELECT_OUT);
+            });
+        }
+    }
+
+    void ready(const shared_socket_t& socket, const error_code_t& error, int mask) {
+        if (!socket->open_m || error == boost::asio::error::operation_aborted)
+            return;
+
+        action(socket->descriptor_m.native_handle(),
+               error ? CURL_CSELECT_ERR : mask);
+
+        // curl may have closed or reconfigured the socket during the action.
+        if (socket->open_m) {
+            arm(socket);
+        }
+    }
+
+    void action(curl_socket_t fd, int mask) {
+        int running(0);
+
+        curl_multi_socket_action(multi_m, fd, mask, &running);
+
+        check_done();
+    }
+
+    void check_done() {
+        int      remaining(0);
+        CURLMsg* message(nullptr);
+
+        while ((message = curl_multi_info_read(multi_m, &remaining))) {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+
+            CURL*    easy = message->easy_handle;
+            CURLcode code = message->data.result;
+            auto     found = transfers_m.find(easy);
+
+            curl_multi_remove_handle(multi_m, easy);
+
+            if (found == transfers_m.end())
+                continue;
+
+            shared_transfer_t transfer(std::move(found->second));
+
+            transfers_m.erase(found);
+
+            std::exception_ptr error;
+
+            try {
+                transfer->curl_m->finish(code);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            complete(transfer, error);
+        }
+    }
+
+    void complete(const shared_transfer_t& transfer, std::exception_ptr error) {
+        --in_flight_m;
+
+        try {
+            transfer->completion_m(*transfer->curl_m, error);
+        } catch (const std::exception& error) {
+            std::cerr << "curl_multi_t completion error: " << error.what() << '\n';
+        } catch (...) {
+            std::cerr << "curl_multi_t completion error: unknown\n";
+        }
+
+        // Hand the curl_t back to its pool now rather than whenever the last
+        // copy of the transfer happens to go away.
+        transfer->curl_m.reset();
+    }
+
+    // The descriptor doesn't own the fd - curl does - so let go of it rather
+    // than closing it out from under curl.
+    void close(socket_t& socket) {
+        socket.open_m = false;
+
+        socket.descriptor_m.release();
+    }
+
+    CURLM*                    multi_m{nullptr};
+    boost::asio::steady_timer timer_m;
+    transfer_map_t            transfers_m;
+    socket_map_t              sockets_m;
+    std::atomic<std::size_t>  in_flight_m{0};
+};
+
+/******************************************************************************/
+
+curl_multi_t::curl_multi_t() : impl_m(new impl_t) {
+}
+
+/******************************************************************************/
+
+void curl_multi_t::perform(curl_pool_t::handle_t curl, completion_t completion) {
+    impl_m->submit(std::chrono::steady_clock::duration::zero(),
+                   std::move(curl),
+                   std::move(completion));
+}
+
+/******************************************************************************/
+
+void curl_multi_t::perform_after(std::chrono::steady_clock::duration delay,
+                                 curl_pool_t::handle_t               curl,
+                                 completion_t                        completion) {
+    impl_m->submit(delay, std::move(curl), std::move(completion));
+}
+
+/******************************************************************************/
+
+std::size_t curl_multi_t::in_flight() const {
+    return impl_m->in_flight();
+}
+
+/******************************************************************************/
+
+void curl_multi_t::set_multiplexing(bool multiplex) {
+    impl_m->set_multiplexing(multiplex);
+}
+
+/******************************************************************************/
@@ -0,0 +1,351 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "decode.hpp"
+
+// stdc++
+#include <cstdint>
+#include <cstring>
+
+// application
+#include "json.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+template <std::size_t N>
+inline bool is(const char* first, std::size_t size, const char (&literal)[N]) {
+    return size == N - 1 && std::memcmp(first, literal, N - 1) == 0;
+}
+
+/******************************************************************************/
+// A perfect hash of the member names the decoders know, computed at compile
+// time for the case labels below: each decoder switches on it with one case
+// per name, so two of its names colliding is a duplicate case label, and
+// won't compile. Names a decoder doesn't know can still land on a case, so
+// the case confirms the name before taking the value (and skips it if it
+// isn't the one.) One hash and one compare per member, however many fields.
+
+constexpr std::uint32_t field_hash(const char* key, std::size_t size) {
+    return size == 0 ?
+               0 :
+               (static_cast<std::uint32_t>(size) +
+                static_cast<unsigned char>(key[0]) * 3 +
+                static_cast<unsigned char>(key[size - 1]) * 2) % 64;
+}
+
+template <std::size_t N>
+constexpr std::uint32_t field_hash(const char (&key)[N]) {
+    return field_hash(key, N - 1);
+}
+
+/******************************************************************************/
+// Same mappings (and defaults) as order_type_cast and direction_cast in
+// stock.cpp.
+
+bool get(const json_view_t& value, stock::order_type_t& result) {
+    const char* first;
+    std::size_t size;
+
+    if (!value.get(first, size))
+        return false;
+
+    if (is(first, size, "market")) {
+        result = stock::order_type_t::market;
+    } else if (is(first, size, "fill-or-kill")) {
+        result = stock::order_type_t::fok;
+    } else if (is(first, size, "immediate-or-cancel")) {
+        result = stock::order_type_t::ioc;
+    } else {
+        result = stock::order_type_t::limit;
+    }
+
+    return true;
+}
+
+bool get(const json_view_t& value, stock::direction_t& result) {
+    const char* first;
+    std::size_t size;
+
+    if (!value.get(first, size))
+        return false;
+
+    result = is(first, size, "sell") ? stock::direction_t::sell : stock::direction_t::buy;
+
+    return true;
+}
+
+/******************************************************************************/
+// A timestamp string; the empty one is no time, as parse_timestamp has it.
+
+bool get(const json_view_t& value, stock::timestamp_t& result) {
+    const char* first;
+    std::size_t size;
+
+    if (!value.get(first, size))
+        return false;
+
+    if (size == 0) {
+        result = 0;
+
+        return true;
+    }
+
+    return stock::parse_timestamp(first, size, result);
+}
+
+/******************************************************************************/
+// A venue, stock or account name, interned.
+
+bool get(const json_view_t& value, stock::symbol_id_t& result) {
+    const char* first;
+    std::size_t size;
+
+    if (!value.get(first, size))
+        return false;
+
+    result = stock::intern_symbol(first, size);
+
+    return true;
+}
+
+/******************************************************************************/
+// "error" may be there, but empty; anything else is left to error_check.
+
+bool no_error(const json_view_t& value) {
+    const char* first;
+    std::size_t size;
+
+    return value.get(first, size) && size == 0;
+}
+
+/******************************************************************************/
+// Each decoder resets its fields to what json_t's accessors give for a
+// missing member (zero, false or empty) and then takes one pass over the
+// members it is given. A member of the wrong shape fails the decode.
+
+bool decode_quote(const json_view_t& json, stock::ticker_t& ticker) {
+    ticker.bid_m = 0;
+    ticker.bid_size_m = 0;
+    ticker.bid_depth_m = 0;
+    ticker.ask_m = 0;
+    ticker.ask_size_m = 0;
+    ticker.ask_depth_m = 0;
+    ticker.last_m = 0;
+    ticker.last_size_m = 0;
+    ticker.last_trade_m = 0;
+    ticker.quote_time_m = 0;
+
+    return json.for_each_member([&](const char* key, std::size_t size, const json_view_t& value) {
+        switch (field_hash(key, size)) {
+            case field_hash("bid"): return !is(key, size, "bid") || value.get(ticker.bid_m);
+            case field_hash("bidSize"): return !is(key, size, "bidSize") || value.get(ticker.bid_size_m);
+            case field_hash("bidDepth"): return !is(key, size, "bidDepth") || value.get(ticker.bid_depth_m);
+            case field_hash("ask"): return !is(key, size, "ask") || value.get(ticker.ask_m);
+            case field_hash("askSize"): return !is(key, size, "askSize") || value.get(ticker.ask_size_m);
+            case field_hash("askDepth"): return !is(key, size, "askDepth") || value.get(ticker.ask_depth_m);
+            case field_hash("last"): return !is(key, size, "last") || value.get(ticker.last_m);
+            case field_hash("lastSize"): return !is(key, size, "lastSize") || value.get(ticker.last_size_m);
+            case field_hash("lastTrade"): return !is(key, size, "lastTrade") || get(value, ticker.last_trade_m);
+            case field_hash("quoteTime"): return !is(key, size, "quoteTime") || get(value, ticker.quote_time_m);
+            default: return true;
+        }
+    });
+}
+
+/******************************************************************************/
+
+bool decode_fill(const json_view_t& json, stock::fill_t& fill) {
+    fill.price_m = 0;
+    fill.quantity_m = 0;
+    fill.ts_m = 0;
+
+    return json.for_each_member([&](const char* key, std::size_t size, const json_view_t& value) {
+        switch (field_hash(key, size)) {
+            case field_hash("price"): return !is(key, size, "price") || value.get(fill.price_m);
+            case field_hash("qty"): return !is(key, size, "qty") || value.get(fill.quantity_m);
+            case field_hash("ts"): return !is(key, size, "ts") || get(value, fill.ts_m);
+            default: return true;
+        }
+    });
+}
+
+/******************************************************************************/
+// The order's spare fills (see fills_t) are written over in place.
+
+bool decode_fills(const json_view_t& json, stock::fills_t& fills) {
+    fills.clear();
+
+    return json.for_each([&](const json_view_t& value) {
+        return decode_fill(value, fills.next());
+    });
+}
+
+/******************************************************************************/
+
+bool decode_order(const json_view_t& json, stock::order_key_t& key, stock::order_t& order) {
+    stock::symbol_id_t venue(0);
+    std::size_t        id(0);
+
+    order.account_m = 0;
+    order.direction_m = stock::direction_t::buy;
+    order.open_m = false;
+    order.type_m = stock::order_type_t::limit;
+    order.original_quantity_m = 0;
+    order.price_m = 0;
+    order.quantity_m = 0;
+    order.symbol_m = 0;
+    order.total_filled_m = 0;
+    order.timestamp_m = 0;
+    order.fills_m.clear();
+
+    bool decoded = json.for_each_member([&](const char* name, std::size_t size, const json_view_t& value) {
+        switch (field_hash(name, size)) {
+            case field_hash("venue"): return !is(name, size, "venue") || get(value, venue);
+            case field_hash("id"): return !is(name, size, "id") || value.get(id);
+            case field_hash("account"): return !is(name, size, "account") || get(value, order.account_m);
+            case field_hash("direction"): return !is(name, size, "direction") || get(value, order.direction_m);
+            case field_hash("open"): return !is(name, size, "open") || value.get(order.open_m);
+            case field_hash("orderType"): return !is(name, size, "orderType") || get(value, order.type_m);
+            case field_hash("originalQty"): return !is(name, size, "originalQty") || value.get(order.original_quantity_m);
+            case field_hash("price"): return !is(name, size, "price") || value.get(order.price_m);
+            case field_hash("qty"): return !is(name, size, "qty") || value.get(order.quantity_m);
+            case field_hash("symbol"): return !is(name, size, "symbol") || get(value, order.symbol_m);
+            case field_hash("totalFilled"): return !is(name, size, "totalFilled") || value.get(order.total_filled_m);
+            case field_hash("ts"): return !is(name, size, "ts") || get(value, order.timestamp_m);
+            case field_hash("fills"): return !is(name, size, "fills") || decode_fills(value, order.fills_m);
+            default: return true;
+        }
+    });
+
+    key = stock::make_order_key(venue, id);
+
+    return decoded;
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+
+bool decode_tick(const char* first, const char* last, ticker_t& ticker) {
+    thread_local json_index_t index;
+
+    if (!index.build(first, last))
+        return false;
+
+    bool ok(false);
+    bool quote(false);
+
+    bool decoded = index.root().for_each_member([&](const char* key, std::size_t size, const json_view_t& value) {
+        switch (field_hash(key, size)) {
+            case field_hash("ok"): return !is(key, size, "ok") || value.get(ok);
+            case field_hash("error"): return !is(key, size, "error") || no_error(value);
+            case field_hash("quote"):
+                if (!is(key, size, "quote"))
+                    return true;
+
+                quote = true;
+
+                return decode_quote(value, ticker);
+            default: return true;
+        }
+    });
+
+    return decoded && ok && quote;
+}
+
+/******************************************************************************/
+
+bool decode_execution(const char*  first,
+                      const char*  last,
+                      order_key_t& key,
+                      execution_t& execution) {
+    thread_local json_index_t index;
+
+    if (!index.build(first, last))
+        return false;
+
+    bool ok(false);
+    bool order(false);
+
+    execution.account_m = 0;
+    execution.venue_m = 0;
+    execution.symbol_m = 0;
+    execution.standing_id_m = 0;
+    execution.incoming_id_m = 0;
+    execution.price_m = 0;
+    execution.filled_m = 0;
+    execution.filled_at_m = 0;
+    execution.standing_complete_m = false;
+    execution.incoming_complete_m = false;
+
+    bool decoded = index.root().for_each_member([&](const char* name, std::size_t size, const json_view_t& value) {
+        switch (field_hash(name, size)) {
+            case field_hash("ok"): return !is(name, size, "ok") || value.get(ok);
+            case field_hash("error"): return !is(name, size, "error") || no_error(value);
+            case field_hash("order"):
+                if (!is(name, size, "order"))
+                    return true;
+
+                order = true;
+
+                return decode_order(value, key, execution.order_m);
+            case field_hash("account"): return !is(name, size, "account") || get(value, execution.account_m);
+            case field_hash("venue"): return !is(name, size, "venue") || get(value, execution.venue_m);
+            case field_hash("symbol"): return !is(name, size, "symbol") || get(value, execution.symbol_m);
+            case field_hash("standingId"): return !is(name, size, "standingId") || value.get(execution.standing_id_m);
+            case field_hash("incomingId"): return !is(name, size, "incomingId") || value.get(execution.incoming_id_m);
+            case field_hash("price"): return !is(name, size, "price") || value.get(execution.price_m);
+            case field_hash("filled"): return !is(name, size, "filled") || value.get(execution.filled_m);
+            case field_hash("filledAt"): return !is(name, size, "filledAt") || get(value, execution.filled_at_m);
+            case field_hash("standingComplete"): return !is(name, size, "standingComplete") || value.get(execution.standing_complete_m);
+            case field_hash("incomingComplete"): return !is(name, size, "incomingComplete") || value.get(execution.incoming_complete_m);
+            default: return true;
+        }
+    });
+
+    return decoded && ok && order;
+}
+
+/******************************************************************************/
+
+ticker_t make_ticker(const json_t& json) {
+    ticker_t      ticker;
+    const json_t& quote = json["quote"];
+
+    ticker.bid_m = quote["bid"].int_value();
+    ticker.bid_size_m = quote["bidSize"].int_value();
+    ticker.bid_depth_m = quote["bidDepth"].int_value();
+
+    ticker.ask_m = quote["ask"].int_value();
+    ticker.ask_size_m = quote["askSize"].int_value();
+    ticker.ask_depth_m = quote["askDepth"].int_value();
+
+    ticker.last_m = quote["last"].int_value();
+    ticker.last_size_m = quote["lastSize"].int_value();
+
+    ticker.last_trade_m = parse_timestamp(quote["lastTrade"].string_value());
+    ticker.quote_time_m = parse_timestamp(quote["quoteTime"].string_value());
+
+    return ticker;
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
@@ -0,0 +1,255 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "depth.hpp"
+
+// stdc++
+#include <algorithm>
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+
+std::size_t depth_book_t::side_t::apply(const levels_t& levels, bool descending, levels_t& scratch) {
+    // Sort and merge the snapshot into one entry per price.
+    scratch.assign(levels.begin(), levels.end());
+
+    std::sort(scratch.begin(), scratch.end(), [](const level_t& x, const level_t& y) {
+        return x.price_m < y.price_m;
+    });
+
+    std::size_t merged{0};
+
+    for (std::size_t i(0); i < scratch.size(); ++i) {
+        if (merged && scratch[merged - 1].price_m == scratch[i].price_m) {
+            scratch[merged - 1].quantity_m += scratch[i].quantity_m;
+        } else {
+            scratch[merged++] = scratch[i];
+        }
+    }
+
+    scratch.resize(merged);
+
+    // Keep the touch in the middle half of the window; when it strays out,
+    // centre the window on it again and rebuild it from the snapshot.
+    bool recentre{false};
+
+    if (!scratch.empty()) {
+        std::size_t touch = descending ? scratch.back().price_m : scratch.front().price_m;
+
+        recentre = quantity_m.empty() ||
+                   touch < base_m + window_k / 4 ||
+                   touch >= base_m + window_k - window_k / 4;
+
+        if (recentre) {
+            quantity_m.assign(window_k, 0);
+
+            base_m = touch > window_k / 2 ? touch - window_k / 2 : 0;
+
+            write_window(scratch);
+        }
+    }
+
+    // Both lists are ascending: a price in only one of them, or in both with
+    // different quantities, has changed, and (unless the window was just
+    // rebuilt) only those are written.
+    std::size_t changed{0};
+    auto        old_level = levels_m.begin();
+    auto        old_last = levels_m.end();
+
+    auto write = [&](std::size_t price, std::size_t old_quantity, std::size_t quantity) {
+        ++changed;
+
+        total_m = total_m - old_quantity + quantity;
+
+        if (!recentre && in_window(price))
+            quantity_m[price - base_m] = quantity;
+    };
+
+    for (const auto& level : scratch) {
+        for (; old_level != old_last && old_level->price_m < level.price_m; ++old_level) {
+            write(old_level->price_m, old_level->quantity_m, 0);
+        }
+
+        if (old_level != old_last && old_level->price_m == level.price_m) {
+            if (old_level->quantity_m != level.quantity_m)
+                write(level.price_m, old_level->quantity_m, level.quantity_m);
+
+            ++old_level;
+        } else {
+            write(level.price_m, 0, level.quantity_m);
+        }
+    }
+
+    for (; old_level != old_last; ++old_level) {
+        write(old_level->price_m, old_level->quantity_m, 0);
+    }
+
+    levels_m.swap(scratch);
+
+    return changed;
+}
+
+/******************************************************************************/
+
+bool depth_book_t::side_t::in_window(std::size_t price) const {
+    return price >= base_m && price - base_m < quantity_m.size();
+}
+
+/******************************************************************************/
+// Writes the levels that fall inside the window.
+
+void depth_book_t::side_t::write_window(const levels_t& levels) {
+    for (const auto& level : levels) {
+        if (in_window(level.price_m)) {
+            quantity_m[level.price_m - base_m] = level.quantity_m;
+        }
+    }
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::side_t::quantity(std::size_t price) const {
+    if (in_window(price))
+        return quantity_m[price - base_m];
+
+    return sum_levels(price, price);
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::side_t::sum_levels(std::size_t first, std::size_t last) const {
+    auto level = std::lower_bound(levels_m.begin(), levels_m.end(), first, [](const level_t& x, std::size_t price) {
+        return x.price_m < price;
+    });
+
+    std::size_t result{0};
+
+    for (; level != levels_m.end() && level->price_m <= last; ++level) {
+        result += level->quantity_m;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+// The window's share is summed from the array; whatever's out beyond it on
+// either side, from the list.
+
+std::size_t depth_book_t::side_t::cumulative(std::size_t first, std::size_t last) const {
+    if (levels_m.empty() || first > last)
+        return 0;
+
+    if (quantity_m.empty())
+        return sum_levels(first, last);
+
+    std::size_t window_last = base_m + quantity_m.size() - 1;
+    std::size_t result{0};
+
+    if (first < base_m)
+        result += sum_levels(first, std::min(last, base_m - 1));
+
+    if (last > window_last)
+        result += sum_levels(std::max(first, window_last + 1), last);
+
+    for (std::size_t price(std::max(first, base_m)); price <= std::min(last, window_last); ++price) {
+        result += quantity_m[price - base_m];
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+levels_t depth_book_t::side_t::walk(std::size_t count, bool descending) const {
+    levels_t result;
+
+    count = std::min(count, levels_m.size());
+
+    for (std::size_t i(0); i < count; ++i) {
+        result.push_back(descending ? levels_m[levels_m.size() - 1 - i] : levels_m[i]);
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::apply(const levels_t& bids, const levels_t& asks) {
+    return bids_m.apply(bids, true, scratch_m) + asks_m.apply(asks, false, scratch_m);
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::best_bid() const {
+    return bids_m.levels_m.empty() ? 0 : bids_m.levels_m.back().price_m;
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::best_ask() const {
+    return asks_m.levels_m.empty() ? 0 : asks_m.levels_m.front().price_m;
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::bid_quantity(std::size_t price) const {
+    return bids_m.quantity(price);
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::ask_quantity(std::size_t price) const {
+    return asks_m.quantity(price);
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::cumulative_bid(std::size_t price) const {
+    return bids_m.cumulative(price, best_bid());
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::cumulative_ask(std::size_t price) const {
+    std::size_t best = best_ask();
+
+    return best ? asks_m.cumulative(best, price) : 0;
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::bid_depth() const {
+    return bids_m.total_m;
+}
+
+/******************************************************************************/
+
+std::size_t depth_book_t::ask_depth() const {
+    return asks_m.total_m;
+}
+
+/******************************************************************************/
+
+levels_t depth_book_t::top_bids(std::size_t count) const {
+    return bids_m.walk(count, true);
+}
+
+/******************************************************************************/
+
+levels_t depth_book_t::top_asks(std::size_t count) const {
+    return asks_m.walk(count, false);
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
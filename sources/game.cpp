@@ -16,12 +16,16 @@
 
 // application
 #include "configuration.hpp"
+#include "decode.hpp"
 #include "json.hpp"
 #include "reentrant.hpp"
 #include "require.hpp"
+#include "sim.hpp"
 #include "str.hpp"
 #include "stock.hpp"
+#include "strand.hpp"
 #include "switches.hpp"
+#include "symbol.hpp"
 #include "websocket.hpp"
 
 /******************************************************************************/
@@ -96,16 +100,10 @@ typedef debounce<std::atomic<std::size_t>> debounce_atomic_size_t;
 /******************************************************************************/
 
 struct gamesocket_t {
-    gamesocket_t(std::string      name,
-                 log_t&           log,
-                 recur::engine_t& recur) :
+    gamesocket_t(std::string name,
+                 log_t&      log) :
         name_m(std::move(name)),
-        log_m(log),
-        recur_m(recur) {
-    }
-
-    ~gamesocket_t() {
-        recur_m.erase(polling_token_m);
+        log_m(log) {
     }
 
     void handle_message(websocket_t::message_handler_t handler) {
@@ -117,9 +115,6 @@ struct gamesocket_t {
 
         socket_m.connect(uri_m);
 
-        polling_token_m = recur_m.insert(std::chrono::milliseconds(100),
-                                         [=](){ poll(); });
-
         socket_m.handle_open([=]() {
             log_m(name_m) << "SOCK : OPEN";
         });
@@ -170,22 +165,28 @@ private:
     gamesocket_t& operator=(const gamesocket_t&) = delete;
     gamesocket_t& operator=(gamesocket_t&&) = delete;
 
-    void poll() {
-        if (socket_m.connected()) {
-            socket_m.poll();
-        }
-    }
-
-    std::string      name_m;
-    log_t&           log_m;
-    recur::engine_t& recur_m;
-    websocket_t      socket_m;
-    std::string      uri_m;
-    recur::token_t   polling_token_m;
+    std::string name_m;
+    log_t&      log_m;
+    websocket_t socket_m;
+    std::string uri_m;
 };
 
 typedef std::shared_ptr<gamesocket_t> shared_gamesocket_t;
 
+/******************************************************************************/
+// A strand per stream the venue sends us, per stock.
+
+enum class stream_t {
+    ticker,
+    executions
+};
+
+strand_map_t::key_t stream_key(stream_t stream, stock::symbol_id_t venue, stock::symbol_id_t symbol) {
+    return static_cast<strand_map_t::key_t>(stream) << 32 |
+           static_cast<strand_map_t::key_t>(venue) << 16 |
+           symbol;
+}
+
 /******************************************************************************/
 
 } // namespace
@@ -197,14 +198,16 @@ struct game_t::impl_t {
         log_m(log),
         recur_m(recur),
         queue_m(queue),
-        ticker_m("TCKR", log_m, recur_m),
-        executions_m("EXEC", log_m, recur_m),
+        strands_m(queue_m),
+        ticker_m("TCKR", log_m),
+        executions_m("EXEC", log_m),
         exec_map_m(log_m, recur_m, engine_m) {
     }
 
     // external apis
     void                            start();
     std::string                     quote();
+    std::string                     depth();
     stock::holdings_t               holdings();
     stock::order_book_t::value_type buy(std::size_t         qty,
                                         std::size_t         price,
@@ -212,6 +215,14 @@ struct game_t::impl_t {
     stock::order_book_t::value_type sell(std::size_t         qty,
                                          std::size_t         price,
                                          stock::order_type_t type = stock::order_type_t::ioc);
+    stock::order_future_t           buy_async(std::size_t         qty,
+                                              std::size_t         price,
+                                              stock::order_type_t type = stock::order_type_t::ioc);
+    stock::order_future_t           sell_async(std::size_t         qty,
+                                               std::size_t         price,
+                                               stock::order_type_t type = stock::order_type_t::ioc);
+
+    std::string                     cancel_all();
 
     // internal apis - called when something in their context changes.
     void world_reaction();
@@ -219,14 +230,33 @@ struct game_t::impl_t {
 
     // recurrent routine(s)
     void world_ping();
+    void reconcile();
+    void depth_ping();
+
+    // runs the level against the in-process simulator instead of the service
+    void simulate();
 
     // websocket handlers
-    void handle_tick(const json_t& message);
-    void handle_execution(const json_t& message);
+    void handle_tick(const std::string& message);
+    void handle_execution(const std::string& message);
+
+    // ... and what they (or the simulator) hand off to
+    void handle_tick(const stock::ticker_t& ticker);
+    void handle_execution(stock::order_key_t key, const stock::execution_t& execution);
+
+    // order logging
+    void log_order(const char*                            tag,
+                   std::size_t                            qty,
+                   std::size_t                            price,
+                   const stock::order_book_t::value_type& order);
+    stock::order_handler_t log_order_handler(const char* tag,
+                                             std::size_t qty,
+                                             std::size_t price);
 
     log_t&              log_m;
     recur::engine_t&    recur_m;
     task_queue_t&       queue_m;
+    strand_map_t        strands_m;
     stock::engine_t     engine_m;
     gamesocket_t        ticker_m;
     gamesocket_t        executions_m;
@@ -238,7 +268,8 @@ struct game_t::impl_t {
     debounce_json_t     last_flash_m;
     stock::ticker_t     last_quote_m;
     stock::ticker_t     cur_quote_m;
-    task_queue_t        order_queue_m{4};
+
+    std::unique_ptr<stock::sim_exchange_t> sim_m;
 };
 
 /******************************************************************************/
@@ -271,35 +302,59 @@ void game_t::impl_t::world_ping() try {
 
 /******************************************************************************/
 
-void game_t::impl_t::handle_tick(const json_t& json) {
+void game_t::impl_t::reconcile() try {
     log_m.instance_identifier() = engine_m.venue();
 
-    stock::ticker_t ticker;
+    if (std::size_t patched = engine_m.reconcile()) {
+        log_m() << "RCNC : " << patched;
+    }
+} catch (const std::exception& error) {
+    log_m() << "EROR : RCNC : " << error.what();
+} catch (...) {
+    log_m() << "EROR : RCNC : unknown";
+}
 
-    const json_t& quote = json["quote"];
+/******************************************************************************/
+
+void game_t::impl_t::depth_ping() try {
+    engine_m.refresh_depth();
+} catch (const std::exception& error) {
+    log_m(engine_m.venue()) << "EROR : BOOK : " << error.what();
+} catch (...) {
+    log_m(engine_m.venue()) << "EROR : BOOK : unknown";
+}
 
-    ticker.bid_m = quote["bid"].int_value();
-    ticker.bid_size_m = quote["bidSize"].int_value();
-    ticker.bid_depth_m = quote["bidDepth"].int_value();
+/******************************************************************************/
 
-    ticker.ask_m = quote["ask"].int_value();
-    ticker.ask_size_m = quote["askSize"].int_value();
-    ticker.ask_depth_m = quote["askDepth"].int_value();
+void game_t::impl_t::handle_tick(const std::string& message) {
+    log_m.instance_identifier() = engine_m.venue();
 
-    ticker.last_m = quote["last"].int_value();
-    ticker.last_size_m = quote["lastSize"].int_value();
+    // The ticker is plain numbers, so decoding into a local costs nothing;
+    // anything decode_tick doesn't expect takes the long way round.
+    stock::ticker_t ticker;
 
-    ticker.last_trade_m = quote["lastTrade"].string_value();
-    ticker.quote_time_m = quote["quoteTime"].string_value();
+    if (!stock::decode_tick(message, ticker)) {
+        json_t json = parse_json(message);
+
+        stock::error_check(json);
+
+        ticker = stock::make_ticker(json);
+    }
 
     static log_t ticker_s(config::derivative_file("_ticker_raw.csv"), false, false);
 
-    ticker_s("") << ticker.quote_time_m
+    ticker_s("") << stock::format_timestamp(ticker.quote_time_m)
                  << ',' << ticker.bid_m
                  << ',' << ticker.last_m
                  << ',' << ticker.ask_m
                  ;
 
+    handle_tick(ticker);
+}
+
+/******************************************************************************/
+
+void game_t::impl_t::handle_tick(const stock::ticker_t& ticker) {
     if (engine_m.update_ticker(ticker, last_quote_m, cur_quote_m)) {
         ticker_reaction();
     }
@@ -365,7 +420,7 @@ void game_t::impl_t::ticker_reaction() {
     bool new_ask = last_ask_s(cur_quote_m.ask_m);
 
     if (new_bid || new_last || new_ask) {
-        bla_s("") << cur_quote_m.quote_time_m << cur_quote_m.bid_m << ',' << cur_quote_m.last_m << ',' << cur_quote_m.ask_m;
+        bla_s("") << stock::format_timestamp(cur_quote_m.quote_time_m) << cur_quote_m.bid_m << ',' << cur_quote_m.last_m << ',' << cur_quote_m.ask_m;
     }
 
     // Handle further events predicated on the ticker here.
@@ -373,30 +428,111 @@ void game_t::impl_t::ticker_reaction() {
 
 /******************************************************************************/
 
-void game_t::impl_t::handle_execution(const json_t& json) {
+void game_t::impl_t::handle_execution(const std::string& message) {
     log_m.instance_identifier() = engine_m.venue();
 
-    stock::execution_t              execution;
-    stock::order_book_t::value_type order{stock::make_order(json["order"])};
+    // As with ticks: decoded in place, with parse_json for the odd ones out.
+    thread_local stock::order_key_t key;
+    thread_local stock::execution_t execution;
+
+    if (!stock::decode_execution(message, key, execution)) {
+        json_t json = parse_json(message);
+
+        stock::error_check(json);
 
-    execution.order_m = std::move(order.second);
+        key = stock::make_order(json["order"]).first;
+        execution = stock::make_execution(json);
+    }
+
+    handle_execution(key, execution);
+}
+
+/******************************************************************************/
 
-    engine_m.update_position(order.first, execution);
+void game_t::impl_t::handle_execution(stock::order_key_t        key,
+                                      const stock::execution_t& execution) {
+    engine_m.update_position(key, execution);
 
     log_m() << "FILL"
             << " : " << (execution.order_m.direction_m == stock::direction_t::buy ? "BUYY" : "SELL")
-            << " : " << order.first.second
+            << " : " << stock::order_key_id(key)
             << " : " << execution.order_m.fills_m.back().quantity_m
-                     << " " << execution.order_m.symbol_m
+                     << " " << stock::symbol_name(execution.order_m.symbol_m)
                      << " @ " << str::to_money(execution.order_m.fills_m.back().price_m)
             << " : " << execution.order_m.total_filled_m << "/" << execution.order_m.original_quantity_m
-            << " : " << execution.order_m.fills_m.back().ts_m
+            << " : " << stock::format_timestamp(execution.order_m.fills_m.back().ts_m)
             ;
 }
 
 /******************************************************************************/
 
+void game_t::impl_t::simulate() try {
+    typedef std::chrono::steady_clock clock_t;
+
+    const config::settings_t& settings = config::settings();
+
+    sim_m.reset(new stock::sim_exchange_t(settings.sim_seed_m));
+
+    engine_m.simulate(*sim_m);
+
+    log_m.instance_identifier() = engine_m.venue();
+
+    log_m() << "SIMU"
+            << " : SEED : " << settings.sim_seed_m
+            << " : " << engine_m.venue()
+            << " : " << engine_m.symbol()
+            << " : " << engine_m.account_m;
+
+    sim_m->handle_tick([=](const stock::ticker_t& ticker) {
+        handle_tick(ticker);
+    });
+
+    sim_m->handle_execution([=](stock::order_key_t        key,
+                                const stock::execution_t& execution) {
+        handle_execution(key, execution);
+    });
+
+    clock_t::time_point start(clock_t::now());
+
+    sim_m->run(settings.sim_events_m);
+
+    double seconds = std::chrono::duration<double>(clock_t::now() - start).count();
+
+    log_m() << "SIMU"
+            << " : EVNT : " << sim_m->events()
+            << " : " << seconds << "s"
+            << " : " << static_cast<std::size_t>(sim_m->events() / seconds) << "/s"
+            << " : SIMT : " << sim_m->now() / 1e9 << "s";
+
+    stock::holdings_t holdings = engine_m.holdings();
+
+    log_m() << "HOLD"
+            << " : CASH : " << str::to_money(holdings.cash_m)
+            << " : POS : " << holdings.position_m
+            << " : NAV : " << str::to_money(holdings.nav_m);
+
+    recur_m.terminate();
+}
+catch (const std::exception& error) {
+    log_m() << "Error : " << error.what();
+
+    recur_m.terminate();
+}
+catch (...) {
+    log_m() << "Error : unknown";
+
+    recur_m.terminate();
+}
+
+/******************************************************************************/
+
 void game_t::impl_t::start() try {
+    if (config::settings().sim_events_m) {
+        simulate();
+
+        return;
+    }
+
     log_m("GAME") << "Attempting connection...";
 
     engine_m.start("first_steps");
@@ -404,38 +540,41 @@ void game_t::impl_t::start() try {
     log_m() << engine_m.id_m
             << " : " << engine_m.venue()
             << " : " << engine_m.symbol()
-            << " : " << engine_m.account_m;
+            << " : " << engine_m.account_m
+            << " : " << stock::transport();
 
     log_m.instance_identifier() = engine_m.venue();
 
     exec_map_m.venue_m = engine_m.venue();
 
-    std::string websocket_url("https://api.stockfighter.io/ob/api/ws/" +
+    std::string websocket_url(stock::api_url() + "ws/" +
                               engine_m.account_m +
                               "/venues/" +
                               engine_m.venue() +
                               "/");
 
-    ticker_m.handle_message([=](const std::string& message) {
-        queue_m.push([=](){
-            json_t json = parse_json(message);
-
-            stock::error_check(json);
-
-            handle_tick(json);
-        });
+    // Each stream's frames are handled one at a time, in the order they came
+    // (so no tick is beaten to the quote by a later one), and a backlog on
+    // one stream doesn't hold up the other. The frames are moved, not copied,
+    // on their way to the workers.
+    stock::symbol_id_t venue = stock::intern_symbol(engine_m.venue());
+    stock::symbol_id_t symbol = stock::intern_symbol(engine_m.symbol());
+    strand_t*          ticks = &strands_m.get(stream_key(stream_t::ticker, venue, symbol));
+    strand_t*          executions = &strands_m.get(stream_key(stream_t::executions, venue, symbol),
+                                                   priority_t::critical);
+
+    ticker_m.handle_message([=](std::string message) {
+        ticks->push(std::bind([=](const std::string& frame){
+            handle_tick(frame);
+        }, std::move(message)));
     });
 
     ticker_m.connect(websocket_url + "tickertape");
 
-    executions_m.handle_message([=](const std::string& message) {
-        queue_m.push([=](){
-            json_t json = parse_json(message);
-
-            stock::error_check(json);
-
-            handle_execution(json);
-        });
+    executions_m.handle_message([=](std::string message) {
+        executions->push(std::bind([=](const std::string& frame){
+            handle_execution(frame);
+        }, std::move(message)));
     });
 
     executions_m.connect(websocket_url + "executions");
@@ -444,7 +583,18 @@ void game_t::impl_t::start() try {
     // the state of things.
     std::size_t world_ping_frequency = engine_m.seconds_per_day_m / 3. * 1000;
     recur_m.insert(std::chrono::milliseconds(world_ping_frequency),
-                   [=](){ world_ping(); });
+                   [=](){ world_ping(); },
+                   priority_t::background);
+
+    // Catch anything the executions socket missed (e.g., while reconnecting.)
+    recur_m.insert(std::chrono::seconds(1), [=](){ reconcile(); }, priority_t::background);
+
+    // The full book, ten times a second.
+    recur_m.insert(std::chrono::milliseconds(100), [=](){ depth_ping(); });
+
+    // Set up a connection per worker now, so the first order doesn't pay for
+    // DNS, TCP and TLS.
+    engine_m.warm_up(queue_m.size());
 
     // Wait for the world to come online.
     engine_m.world_wide_wait();
@@ -463,12 +613,36 @@ catch (...) {
 /******************************************************************************/
 
 std::string game_t::impl_t::quote() {
+    stock::ticker_t   quote = engine_m.quote(); // one snapshot; the ticker strand writes cur_quote_m
     std::stringstream stream;
 
     stream << "QUOT"
-           << " : " << cur_quote_m.bid_m << " (" << cur_quote_m.bid_size_m << ")"
-           << " : " << cur_quote_m.last_m << " (" << cur_quote_m.last_size_m << ")"
-           << " : " << cur_quote_m.ask_m << " (" << cur_quote_m.ask_size_m << ")";
+           << " : " << quote.bid_m << " (" << quote.bid_size_m << ")"
+           << " : " << quote.last_m << " (" << quote.last_size_m << ")"
+           << " : " << quote.ask_m << " (" << quote.ask_size_m << ")";
+
+    return stream.str();
+}
+
+/******************************************************************************/
+
+std::string game_t::impl_t::depth() {
+    stock::depth_book_t book = engine_m.depth();
+    std::stringstream   stream;
+
+    stream << "BOOK"
+           << " : BID : " << book.bid_depth();
+
+    for (const auto& level : book.top_bids(5)) {
+        stream << " : " << level.price_m << " (" << level.quantity_m << ")";
+    }
+
+    stream << "\nBOOK"
+           << " : ASK : " << book.ask_depth();
+
+    for (const auto& level : book.top_asks(5)) {
+        stream << " : " << level.price_m << " (" << level.quantity_m << ")";
+    }
 
     return stream.str();
 }
@@ -481,17 +655,42 @@ stock::holdings_t game_t::impl_t::holdings() {
 
 /******************************************************************************/
 
+void game_t::impl_t::log_order(const char*                            tag,
+                               std::size_t                            qty,
+                               std::size_t                            price,
+                               const stock::order_book_t::value_type& order) {
+    log_m.instance_identifier() = engine_m.venue();
+
+    log_m() << "ORDR : " << tag
+            << " : " << qty << " @ " << str::to_money(price)
+            << " : " << stock::order_key_id(order.first)
+            << " : " << order.second.total_filled_m << "/" << order.second.original_quantity_m;
+}
+
+/******************************************************************************/
+
+stock::order_handler_t game_t::impl_t::log_order_handler(const char* tag,
+                                                         std::size_t qty,
+                                                         std::size_t price) {
+    return [=](const stock::order_future_t& future) {
+        try {
+            log_order(tag, qty, price, future.get());
+        } catch (const std::exception& error) {
+            log_m() << "EROR : ORDR : " << tag << " : " << error.what();
+        } catch (...) {
+            log_m() << "EROR : ORDR : " << tag << " : unknown";
+        }
+    };
+}
+
+/******************************************************************************/
+
 stock::order_book_t::value_type game_t::impl_t::buy(std::size_t         qty,
                                                     std::size_t         price,
                                                     stock::order_type_t type) {
-    log_m.instance_identifier() = engine_m.venue();
-
     stock::order_book_t::value_type order = engine_m.buy(price, qty, type);
 
-    log_m() << "ORDR : BUYY"
-            << " : " << qty << " @ " << str::to_money(price)
-            << " : " << order.first.second
-            << " : " << order.second.total_filled_m << "/" << order.second.original_quantity_m;
+    log_order("BUYY", qty, price, order);
 
     return order;
 }
@@ -501,18 +700,52 @@ stock::order_book_t::value_type game_t::impl_t::buy(std::size_t         qty,
 stock::order_book_t::value_type game_t::impl_t::sell(std::size_t         qty,
                                                      std::size_t         price,
                                                      stock::order_type_t type) {
-    log_m.instance_identifier() = engine_m.venue();
-
     stock::order_book_t::value_type order = engine_m.sell(price, qty, type);
 
-    log_m() << "ORDR : SELL"
-            << " : " << qty << " @ " << str::to_money(price)
-            << " : " << order.first.second
-            << " : " << order.second.total_filled_m << "/" << order.second.original_quantity_m;
+    log_order("SELL", qty, price, order);
 
     return order;
 }
 
+/******************************************************************************/
+
+stock::order_future_t game_t::impl_t::buy_async(std::size_t         qty,
+                                                std::size_t         price,
+                                                stock::order_type_t type) {
+    return engine_m.buy_async(price, qty, type, log_order_handler("BUYY", qty, price));
+}
+
+/******************************************************************************/
+
+stock::order_future_t game_t::impl_t::sell_async(std::size_t         qty,
+                                                 std::size_t         price,
+                                                 stock::order_type_t type) {
+    return engine_m.sell_async(price, qty, type, log_order_handler("SELL", qty, price));
+}
+
+/******************************************************************************/
+
+std::string game_t::impl_t::cancel_all() {
+    log_m.instance_identifier() = engine_m.venue();
+
+    stock::cancel_report_t report = engine_m.cancel_all_open();
+    auto                   ms = std::chrono::duration_cast<std::chrono::microseconds>(report.elapsed_m);
+    std::stringstream      stream;
+
+    stream << "CNCL : ALL"
+           << " : " << report.canceled_m << "/" << report.requested_m
+           << " : " << (ms.count() / 1000.) << "ms"
+           << " : " << (report.flat_m ? "FLAT" : "OPEN");
+
+    log_m() << stream.str();
+
+    for (const auto& failure : report.failures_m) {
+        log_m() << "EROR : CNCL : " << failure.first << " : " << failure.second;
+    }
+
+    return stream.str();
+}
+
 /******************************************************************************/
 #if 0
 #pragma mark -
@@ -539,6 +772,12 @@ std::string game_t::quote() {
 
 /******************************************************************************/
 
+std::string game_t::depth() {
+    return impl_m->depth();
+}
+
+/******************************************************************************/
+
 stock::holdings_t game_t::holdings() {
     return impl_m->holdings();
 }
@@ -546,13 +785,19 @@ stock::holdings_t game_t::holdings() {
 /******************************************************************************/
 
 void game_t::buy(std::size_t qty, std::size_t price) {
-    impl_m->buy(qty, price);
+    impl_m->buy_async(qty, price);
 }
 
 /******************************************************************************/
 
 void game_t::sell(std::size_t qty, std::size_t price) {
-    impl_m->sell(qty, price);
+    impl_m->sell_async(qty, price);
+}
+
+/******************************************************************************/
+
+std::string game_t::cancel_all() {
+    return impl_m->cancel_all();
 }
 
 /******************************************************************************/
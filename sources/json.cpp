@@ -8,8 +8,174 @@
 // identity
 #include "json.hpp"
 
+// stdc++
+#include <cstring>
+#include <limits>
+
 // application
 #include "error.hpp"
+#include "switches.hpp"
+
+#if qX86
+    #include <immintrin.h>
+#endif
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+const std::size_t block_size_k = 32;
+const std::size_t npos_k = std::numeric_limits<std::size_t>::max();
+
+/******************************************************************************/
+// One bit per byte of a 32-byte block.
+
+struct block_masks_t {
+    std::uint32_t quote_m;     // '"'
+    std::uint32_t backslash_m; // '\\'
+    std::uint32_t op_m;        // '{', '}', '[', ']', ':' or ','
+};
+
+typedef void (*classify_proc_t)(const char*, block_masks_t&);
+
+/******************************************************************************/
+
+void classify_scalar(const char* p, block_masks_t& masks) {
+    masks.quote_m = 0;
+    masks.backslash_m = 0;
+    masks.op_m = 0;
+
+    for (std::size_t i(0); i < block_size_k; ++i) {
+        std::uint32_t bit = std::uint32_t(1) << i;
+
+        switch (p[i]) {
+            case '"': masks.quote_m |= bit; break;
+            case '\\': masks.backslash_m |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                masks.op_m |= bit;
+                break;
+        }
+    }
+}
+
+/******************************************************************************/
+
+#if qX86
+
+// pcmpestrm does the set membership test for the six operators in one go.
+__attribute__((target("sse4.2")))
+void classify_sse42(const char* p, block_masks_t& masks) {
+    const __m128i ops = _mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    masks.quote_m = 0;
+    masks.backslash_m = 0;
+    masks.op_m = 0;
+
+    for (int half(0); half < 2; ++half) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + half * 16));
+        __m128i op = _mm_cmpestrm(ops, 6, chunk, 16,
+                                  _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_UNIT_MASK);
+        int     shift = half * 16;
+
+        masks.quote_m |= std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote))) << shift;
+        masks.backslash_m |= std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash))) << shift;
+        masks.op_m |= std::uint32_t(_mm_movemask_epi8(op)) << shift;
+    }
+}
+
+/******************************************************************************/
+// Setting bit 0x20 folds '[' onto '{' and ']' onto '}' (':' and ',' already
+// have it), so four compares cover the six operators.
+
+__attribute__((target("avx2")))
+void classify_avx2(const char* p, block_masks_t& masks) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    __m256i op = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8(':')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8(','))));
+
+    masks.quote_m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')));
+    masks.backslash_m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+    masks.op_m = _mm256_movemask_epi8(op);
+}
+
+#endif
+
+/******************************************************************************/
+
+struct kernel_t {
+    classify_proc_t proc_m;
+    const char*     name_m;
+};
+
+const kernel_t& active_kernel() {
+    static const kernel_t kernel_s = []() -> kernel_t {
+#if qX86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            return kernel_t{&classify_avx2, "AVX2"};
+
+        if (__builtin_cpu_supports("sse4.2"))
+            return kernel_t{&classify_sse42, "SSE4.2"};
+#endif
+
+        return kernel_t{&classify_scalar, "SCALAR"};
+    }();
+
+    return kernel_s;
+}
+
+/******************************************************************************/
+// Bit i of the result is the parity of bits 0 through i: with quotes as the
+// input, that's "inside a string" from each opening quote up to (but not
+// including) its closing one.
+
+inline std::uint32_t prefix_xor(std::uint32_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+
+    return x;
+}
+
+/******************************************************************************/
+// The bytes escaped by a backslash. Only reached for blocks with a backslash
+// in (or running into) them, which our traffic almost never has.
+
+std::uint32_t escaped(std::uint32_t backslash, bool& carry) {
+    std::uint32_t result(0);
+
+    for (std::size_t i(0); i < block_size_k; ++i) {
+        if (carry) {
+            result |= std::uint32_t(1) << i;
+            carry = false;
+        } else if (backslash & (std::uint32_t(1) << i)) {
+            carry = true;
+        }
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+inline bool space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/******************************************************************************/
+
+} // namespace
 
 /******************************************************************************/
 
@@ -24,3 +190,278 @@ json_t parse_json(const std::string& json_raw) {
 }
 
 /******************************************************************************/
+
+bool json_index_t::build(const char* first, const char* last) {
+    classify_proc_t classify = active_kernel().proc_m;
+    std::size_t     size = last - first;
+    std::uint32_t   in_string(0); // all ones while a string runs past a block
+    bool            escape(false);
+
+    first_m = first;
+    last_m = last;
+
+    // At most one structural per byte; growing (and not shrinking) up front
+    // keeps the per-block loop free of capacity checks.
+    if (positions_m.size() < size)
+        positions_m.resize(size);
+
+    std::uint32_t* out = positions_m.data();
+
+    for (std::size_t offset(0); offset < size; offset += block_size_k) {
+        const char* p = first + offset;
+        char        tail[block_size_k];
+
+        // Pad the last partial block with whitespace rather than read past
+        // the payload.
+        if (size - offset < block_size_k) {
+            std::memset(tail, ' ', block_size_k);
+            std::memcpy(tail, p, size - offset);
+
+            p = tail;
+        }
+
+        block_masks_t masks;
+
+        classify(p, masks);
+
+        std::uint32_t quote = masks.quote_m;
+
+        if (masks.backslash_m || escape)
+            quote &= ~escaped(masks.backslash_m, escape);
+
+        std::uint32_t inside = prefix_xor(quote) ^ in_string;
+        std::uint32_t structural = (masks.op_m & ~inside) | quote;
+
+        in_string = inside & 0x80000000 ? 0xffffffff : 0;
+
+        while (structural) {
+            *out++ = static_cast<std::uint32_t>(offset + __builtin_ctz(structural));
+
+            structural &= structural - 1;
+        }
+    }
+
+    count_m = out - positions_m.data();
+    built_m = !in_string && match();
+
+    return built_m;
+}
+
+/******************************************************************************/
+// Pairs up the brackets, so that stepping over an object or array is a lookup
+// rather than a walk.
+
+bool json_index_t::match() {
+    if (closes_m.size() < count_m)
+        closes_m.resize(count_m);
+
+    std::size_t depth(0);
+
+    for (std::size_t i(0); i < count_m; ++i) {
+        char c = first_m[positions_m[i]];
+
+        if (c == '{' || c == '[') {
+            if (depth == opens_m.size())
+                opens_m.push_back(i);
+            else
+                opens_m[depth] = i;
+
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0)
+                return false;
+
+            std::uint32_t open = opens_m[--depth];
+
+            if (first_m[positions_m[open]] != (c == '}' ? '{' : '['))
+                return false;
+
+            closes_m[open] = i;
+        }
+    }
+
+    return depth == 0;
+}
+
+/******************************************************************************/
+
+json_view_t json_index_t::root() const {
+    const char* p = first_m;
+
+    while (p != last_m && space(*p))
+        ++p;
+
+    if (!built_m || p == last_m || !count_m || first_m + positions_m[0] != p)
+        return json_view_t();
+
+    json_view_t result(*this, p, 0);
+
+    if ((!result.is_object() && !result.is_array()) || closes_m[0] != count_m - 1)
+        return json_view_t();
+
+    for (p = first_m + positions_m[count_m - 1] + 1; p != last_m; ++p)
+        if (!space(*p))
+            return json_view_t();
+
+    return result;
+}
+
+/******************************************************************************/
+
+const char* json_index_t::kernel() {
+    return active_kernel().name_m;
+}
+
+/******************************************************************************/
+
+json_view_t::json_view_t(const json_index_t& index, const char* first, std::size_t next) :
+    index_m(&index),
+    first_m(first),
+    next_m(next) {
+}
+
+/******************************************************************************/
+
+char json_view_t::at(std::size_t structural) const {
+    return structural < index_m->count_m ?
+               index_m->first_m[index_m->positions_m[structural]] :
+               '\0';
+}
+
+/******************************************************************************/
+
+json_view_t json_view_t::after(std::size_t structural) const {
+    if (structural >= index_m->count_m)
+        return json_view_t();
+
+    const char* p = index_m->first_m + index_m->positions_m[structural] + 1;
+
+    while (p != index_m->last_m && space(*p))
+        ++p;
+
+    if (p == index_m->last_m)
+        return json_view_t();
+
+    return json_view_t(*index_m, p, structural + 1);
+}
+
+/******************************************************************************/
+
+std::size_t json_view_t::skip() const {
+    switch (*first_m) {
+        case '"':
+            return next_m + 1 < index_m->count_m ? next_m + 2 : npos_k;
+
+        case '{':
+        case '[':
+            return index_m->closes_m[next_m] + 1;
+
+        default:
+            // a number or literal runs up to the next structural
+            return next_m;
+    }
+}
+
+/******************************************************************************/
+
+bool json_view_t::key(std::size_t structural, const char*& first, std::size_t& size) const {
+    if (at(structural) != '"' || at(structural + 1) != '"' || at(structural + 2) != ':')
+        return false;
+
+    const auto& positions = index_m->positions_m;
+
+    first = index_m->first_m + positions[structural] + 1;
+    size = positions[structural + 1] - positions[structural] - 1;
+
+    return true;
+}
+
+/******************************************************************************/
+
+json_view_t json_view_t::operator[](const char* key) const {
+    std::size_t key_size = std::strlen(key);
+    json_view_t result;
+
+    for_each_member([&](const char* first, std::size_t size, const json_view_t& value) {
+        if (size != key_size || std::memcmp(first, key, size) != 0)
+            return true;
+
+        result = value;
+
+        return false;
+    });
+
+    return result;
+}
+
+/******************************************************************************/
+
+bool json_view_t::get(std::size_t& value) const {
+    if (!valid())
+        return false;
+
+    const char* p = first_m;
+    const char* last = index_m->last_m;
+    std::size_t result(0);
+    std::size_t digits(0);
+
+    for (; p != last && *p >= '0' && *p <= '9'; ++p, ++digits)
+        result = result * 10 + (*p - '0');
+
+    if (digits == 0 || digits > 9 ||
+        (p != last && (*p == '.' || *p == 'e' || *p == 'E')))
+        return false;
+
+    value = result;
+
+    return true;
+}
+
+/******************************************************************************/
+
+bool json_view_t::get(bool& value) const {
+    if (!valid())
+        return false;
+
+    std::size_t room = index_m->last_m - first_m;
+
+    if (room >= 4 && std::memcmp(first_m, "true", 4) == 0) {
+        value = true;
+    } else if (room >= 5 && std::memcmp(first_m, "false", 5) == 0) {
+        value = false;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+
+bool json_view_t::get(const char*& first, std::size_t& size) const {
+    if (!valid() || *first_m != '"' || at(next_m + 1) != '"')
+        return false;
+
+    const char* close = index_m->first_m + index_m->positions_m[next_m + 1];
+
+    first = first_m + 1;
+    size = close - first;
+
+    return std::memchr(first, '\\', size) == nullptr;
+}
+
+/******************************************************************************/
+
+bool json_view_t::get(std::string& value) const {
+    const char* first;
+    std::size_t size;
+
+    if (!get(first, size))
+        return false;
+
+    value.assign(first, size);
+
+    return true;
+}
+
+/******************************************************************************/
@@ -41,6 +41,9 @@ void keepalive(log_t& log, recur::engine_t& recur) {
 
         recur.terminate();
     }
+
+    // Keep the pooled connections hot for the next order.
+    stock::keep_warm();
 }
 
 /******************************************************************************/
@@ -63,14 +66,22 @@ int main(int argc, char** argv) try {
         return 1;
     }
 
+    const config::settings_t& settings = config::settings();
+    idle_policy_t             idle_policy;
+
+    idle_policy.spin_m = settings.idle_spin_m;
+    idle_policy.yield_m = settings.idle_yield_m;
+    idle_policy.hot_m = settings.hot_workers_m;
+
     log_t           log(config::derivative_file(".log"), true, false);
-    task_queue_t    queue{6};
+    task_queue_t    queue{6, idle_policy};
     recur::engine_t recur{queue};
     game_t          game(log, recur, queue);
 
     std::thread([&](){ console(log, recur, queue, game); }).detach();
 
-    recur.insert(std::chrono::minutes(1), [&](){ keepalive(log, recur); });
+    // Often enough to beat typical server-side idle connection timeouts.
+    recur.insert(std::chrono::seconds(30), [&](){ keepalive(log, recur); }, priority_t::background);
 
     log("MAIN") << "Startup";
 
@@ -80,6 +91,18 @@ int main(int argc, char** argv) try {
 
     recur.run();
 
+    for (const auto& line : stock::latency_report()) {
+        log("MAIN") << line;
+    }
+
+    for (const auto& line : queue.lane_report()) {
+        log("MAIN") << line;
+    }
+
+    for (const auto& line : queue.wake_report()) {
+        log("MAIN") << line;
+    }
+
     return 0;
 } catch (const std::exception& error) {
     std::cerr << "Fatal error : " << error.what() << '\n';
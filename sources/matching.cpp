@@ -0,0 +1,423 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "matching.hpp"
+
+// stdc++
+#include <algorithm>
+
+// application
+#include "error.hpp"
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+
+matching_engine_t::matching_engine_t(const std::string& venue, const std::string& symbol) :
+    venue_m(intern_symbol(venue)),
+    symbol_m(intern_symbol(symbol)),
+    quote_m() {
+}
+
+/******************************************************************************/
+
+void matching_engine_t::handle_execution(execution_handler_t handler) {
+    lock_t lock{mutex_m};
+
+    execution_handler_m = std::move(handler);
+}
+
+/******************************************************************************/
+
+void matching_engine_t::add_background_account(symbol_id_t account) {
+    lock_t lock{mutex_m};
+
+    background_m.insert(account);
+}
+
+/******************************************************************************/
+// Total quantity an order on the other side could take out. Bids and asks
+// are both ordered best-first, so the side's comparator tells when a level is
+// priced past the limit.
+
+template <typename Side>
+std::size_t matching_engine_t::available(const Side& side,
+                                         std::size_t price,
+                                         bool        priced) const {
+    std::size_t result(0);
+
+    for (const auto& level : side) {
+        if (priced && side.key_comp()(price, level.first))
+            break;
+
+        result += level.second.quantity_m;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+// Queues one side's execution report (unless the side is background flow.)
+
+void matching_engine_t::report(const entry_t&     entry,
+                               std::size_t        id,
+                               const execution_t& execution,
+                               executions_t&      executions) const {
+    if (entry.background_m)
+        return;
+
+    executions.emplace_back(id, execution);
+
+    executions.back().second.account_m = entry.order_m.account_m;
+    executions.back().second.order_m = entry.order_m;
+}
+
+/******************************************************************************/
+
+template <typename Side>
+void matching_engine_t::match(Side&              side,
+                              entry_t&           incoming_entry,
+                              std::size_t        incoming_id,
+                              bool               priced,
+                              timestamp_t        ts,
+                              executions_t&      executions) {
+    order_t& incoming = incoming_entry.order_m;
+
+    while (incoming.quantity_m && !side.empty()) {
+        auto level = side.begin();
+
+        if (priced && side.key_comp()(incoming.price_m, level->first))
+            break;
+
+        std::deque<std::size_t>& queue = level->second.queue_m;
+
+        while (incoming.quantity_m && !queue.empty()) {
+            std::size_t standing_id = queue.front();
+            auto        found = orders_m.find(standing_id);
+            entry_t&    standing_entry = found->second;
+            order_t&    standing = standing_entry.order_m;
+            std::size_t filled = std::min(incoming.quantity_m, standing.quantity_m);
+            fill_t      fill{level->first, filled, ts};
+
+            standing.fills_m.push_back(fill);
+            standing.quantity_m -= filled;
+            standing.total_filled_m += filled;
+
+            incoming.fills_m.push_back(fill);
+            incoming.quantity_m -= filled;
+            incoming.total_filled_m += filled;
+
+            level->second.quantity_m -= filled;
+            depth(side) -= filled;
+
+            if (!standing.quantity_m) {
+                standing.open_m = false;
+
+                queue.pop_front();
+            }
+
+            quote_m.last_m = level->first;
+            quote_m.last_size_m = filled;
+            quote_m.last_trade_m = ts;
+
+            if (execution_handler_m) {
+                execution_t execution;
+
+                execution.venue_m = venue_m;
+                execution.symbol_m = symbol_m;
+                execution.standing_id_m = standing_id;
+                execution.incoming_id_m = incoming_id;
+                execution.price_m = level->first;
+                execution.filled_m = filled;
+                execution.filled_at_m = ts;
+                execution.standing_complete_m = standing.quantity_m == 0;
+                execution.incoming_complete_m = incoming.quantity_m == 0;
+
+                report(standing_entry, standing_id, execution, executions);
+                report(incoming_entry, incoming_id, execution, executions);
+            }
+
+            if (!standing.open_m && standing_entry.background_m)
+                orders_m.erase(found);
+        }
+
+        if (queue.empty())
+            side.erase(level);
+    }
+}
+
+/******************************************************************************/
+
+template <typename Side>
+void matching_engine_t::rest(Side& side, std::size_t id, const order_t& order) {
+    price_level_t& level = side[order.price_m];
+
+    level.queue_m.push_back(id);
+    level.quantity_m += order.quantity_m;
+    depth(side) += order.quantity_m;
+}
+
+/******************************************************************************/
+
+template <typename Side>
+void matching_engine_t::unrest(Side& side, std::size_t id, const order_t& order) {
+    auto level = side.find(order.price_m);
+
+    if (level == side.end())
+        return;
+
+    std::deque<std::size_t>& queue = level->second.queue_m;
+
+    queue.erase(std::remove(queue.begin(), queue.end(), id), queue.end());
+
+    level->second.quantity_m -= order.quantity_m;
+    depth(side) -= order.quantity_m;
+
+    if (queue.empty())
+        side.erase(level);
+}
+
+/******************************************************************************/
+
+void matching_engine_t::update_quote(timestamp_t ts) {
+    quote_m.bid_m = bids_m.empty() ? 0 : bids_m.begin()->first;
+    quote_m.bid_size_m = bids_m.empty() ? 0 : bids_m.begin()->second.quantity_m;
+    quote_m.bid_depth_m = bid_depth_m;
+
+    quote_m.ask_m = asks_m.empty() ? 0 : asks_m.begin()->first;
+    quote_m.ask_size_m = asks_m.empty() ? 0 : asks_m.begin()->second.quantity_m;
+    quote_m.ask_depth_m = ask_depth_m;
+
+    quote_m.quote_time_m = ts;
+}
+
+/******************************************************************************/
+
+const matching_engine_t::entry_t& matching_engine_t::entry(std::size_t id) const {
+    auto found = orders_m.find(id);
+
+    if (found == orders_m.end())
+        throw_error("No such order: " + std::to_string(id));
+
+    return found->second;
+}
+
+/******************************************************************************/
+
+order_book_t::value_type matching_engine_t::value(std::size_t id, const order_t& order) const {
+    return order_book_t::value_type{make_order_key(venue_m, id), order};
+}
+
+/******************************************************************************/
+
+void matching_engine_t::notify(const executions_t& executions) {
+    if (executions.empty())
+        return;
+
+    execution_handler_t handler;
+
+    /* book lock scope */ {
+        lock_t lock{mutex_m};
+
+        handler = execution_handler_m;
+    }
+
+    if (!handler)
+        return;
+
+    for (const auto& execution : executions) {
+        handler(execution.first, execution.second);
+    }
+}
+
+/******************************************************************************/
+
+order_book_t::value_type matching_engine_t::submit(symbol_id_t  account,
+                                                   direction_t  direction,
+                                                   order_type_t type,
+                                                   std::size_t  price,
+                                                   std::size_t  quantity,
+                                                   timestamp_t  ts) {
+    executions_t executions;
+    std::size_t  id(0);
+    order_t      result;
+
+    /* book lock scope */ {
+        lock_t lock{mutex_m};
+
+        id = next_id_m++;
+
+        auto     inserted = orders_m.emplace(id, entry_t()).first;
+        entry_t& entry = inserted->second;
+        order_t& incoming = entry.order_m;
+
+        entry.background_m = background_m.count(account) != 0;
+
+        incoming.open_m = quantity != 0;
+        incoming.account_m = account;
+        incoming.symbol_m = symbol_m;
+        incoming.direction_m = direction;
+        incoming.type_m = type;
+        incoming.original_quantity_m = quantity;
+        incoming.price_m = price;
+        incoming.quantity_m = quantity;
+        incoming.timestamp_m = ts;
+
+        bool buy = direction == direction_t::buy;
+        bool priced = type != order_type_t::market;
+
+        // Fill-or-kill either trades in full right now or not at all.
+        bool killed = type == order_type_t::fok &&
+                      (buy ? available(asks_m, price, priced) :
+                             available(bids_m, price, priced)) < quantity;
+
+        if (!killed) {
+            if (buy) {
+                match(asks_m, entry, id, priced, ts, executions);
+            } else {
+                match(bids_m, entry, id, priced, ts, executions);
+            }
+        }
+
+        if (incoming.quantity_m && type == order_type_t::limit) {
+            if (buy) {
+                rest(bids_m, id, incoming);
+            } else {
+                rest(asks_m, id, incoming);
+            }
+        } else {
+            // Whatever didn't trade (market, fok, ioc) is canceled outright.
+            incoming.quantity_m = 0;
+            incoming.open_m = false;
+        }
+
+        update_quote(ts);
+
+        result = incoming;
+
+        if (!incoming.open_m && entry.background_m)
+            orders_m.erase(inserted);
+    }
+
+    notify(executions);
+
+    return order_book_t::value_type{make_order_key(venue_m, id), std::move(result)};
+}
+
+/******************************************************************************/
+
+order_book_t::value_type matching_engine_t::cancel(std::size_t id, timestamp_t ts) {
+    lock_t lock{mutex_m};
+    auto   found = orders_m.find(id);
+
+    if (found == orders_m.end())
+        throw_error("No such order: " + std::to_string(id));
+
+    order_t& order = found->second.order_m;
+
+    if (order.open_m) {
+        if (order.direction_m == direction_t::buy) {
+            unrest(bids_m, id, order);
+        } else {
+            unrest(asks_m, id, order);
+        }
+
+        order.quantity_m = 0;
+        order.open_m = false;
+
+        update_quote(ts);
+    }
+
+    order_book_t::value_type result = value(id, order);
+
+    if (found->second.background_m)
+        orders_m.erase(found);
+
+    return result;
+}
+
+/******************************************************************************/
+
+order_book_t::value_type matching_engine_t::status(std::size_t id) const {
+    lock_t lock{mutex_m};
+
+    return value(id, entry(id).order_m);
+}
+
+/******************************************************************************/
+
+bool matching_engine_t::open(std::size_t id) const {
+    lock_t lock{mutex_m};
+    auto   found = orders_m.find(id);
+
+    return found != orders_m.end() && found->second.order_m.open_m;
+}
+
+/******************************************************************************/
+
+std::vector<order_book_t::value_type> matching_engine_t::orders(symbol_id_t account) const {
+    lock_t                                lock{mutex_m};
+    std::vector<order_book_t::value_type> result;
+
+    for (const auto& order : orders_m) {
+        if (order.second.order_m.account_m == account) {
+            result.push_back(value(order.first, order.second.order_m));
+        }
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+ticker_t matching_engine_t::quote() const {
+    lock_t lock{mutex_m};
+
+    return quote_m;
+}
+
+/******************************************************************************/
+
+void matching_engine_t::levels(levels_t& bids, levels_t& asks) const {
+    lock_t lock{mutex_m};
+
+    bids.clear();
+    asks.clear();
+
+    stock::level_t result;
+
+    for (const auto& level : bids_m) {
+        result.price_m = level.first;
+        result.quantity_m = level.second.quantity_m;
+
+        bids.push_back(result);
+    }
+
+    for (const auto& level : asks_m) {
+        result.price_m = level.first;
+        result.quantity_m = level.second.quantity_m;
+
+        asks.push_back(result);
+    }
+}
+
+/******************************************************************************/
+
+std::size_t matching_engine_t::order_count() const {
+    lock_t lock{mutex_m};
+
+    return next_id_m;
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
@@ -0,0 +1,89 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "service.hpp"
+
+// stdc++
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// application
+#include "switches.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+struct runner_t {
+    runner_t() :
+        work_m(new boost::asio::io_service::work(service::io())),
+        thread_m(std::bind(&runner_t::run, this)) {
+    }
+
+    ~runner_t() {
+        work_m.reset();
+
+        service::io().stop();
+
+        thread_m.join();
+    }
+
+private:
+    void run() {
+#if qMac
+        pthread_setname_np("io service");
+#endif
+
+        while (true) try {
+            service::io().run();
+
+            return;
+        } catch (const std::exception& error) {
+            std::cerr << "service error: " << error.what() << '\n';
+        } catch (...) {
+            std::cerr << "service error: unknown\n";
+        }
+    }
+
+    std::unique_ptr<boost::asio::io_service::work> work_m;
+    std::thread                                    thread_m;
+};
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace service {
+
+/******************************************************************************/
+
+boost::asio::io_service& io() {
+    static boost::asio::io_service service_s;
+    return service_s;
+}
+
+/******************************************************************************/
+
+void start() {
+    // Touch the service first so it outlives the runner at static destruction.
+    io();
+
+    static runner_t runner_s;
+}
+
+/******************************************************************************/
+
+} // namespace service
+
+/******************************************************************************/
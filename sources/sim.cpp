@@ -0,0 +1,235 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "sim.hpp"
+
+// stdc++
+#include <algorithm>
+
+// application
+#include "error.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+const std::size_t max_open_k = 100; // resting background orders
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+
+sim_exchange_t::sim_exchange_t(std::uint64_t seed,
+                               std::string   venue,
+                               std::string   symbol,
+                               std::string   account) :
+    engine_m(std::move(venue), std::move(symbol)),
+    account_m(std::move(account)),
+    account_id_m(intern_symbol(account_m)),
+    random_m(seed) {
+    // Background orders get no reports, so every execution here is ours.
+    engine_m.add_background_account(bot_account_m);
+
+    engine_m.handle_execution([this](std::size_t id, const execution_t& execution) {
+        executions_m.emplace_back(make_order_key(engine_m.venue_id(), id), execution);
+    });
+}
+
+/******************************************************************************/
+
+void sim_exchange_t::handle_tick(tick_handler_t handler) {
+    lock_t lock{mutex_m};
+
+    tick_handler_m = std::move(handler);
+}
+
+/******************************************************************************/
+
+void sim_exchange_t::handle_execution(execution_handler_t handler) {
+    lock_t lock{mutex_m};
+
+    execution_handler_m = std::move(handler);
+}
+
+/******************************************************************************/
+
+order_book_t::value_type sim_exchange_t::submit(direction_t  direction,
+                                                order_type_t type,
+                                                std::size_t  price,
+                                                std::size_t  quantity) {
+    lock_t lock{mutex_m};
+
+    ticked_m = true;
+
+    return engine_m.submit(account_id_m, direction, type, price, quantity, stamp());
+}
+
+/******************************************************************************/
+
+order_book_t::value_type sim_exchange_t::cancel(std::size_t id) {
+    lock_t lock{mutex_m};
+
+    if (engine_m.status(id).second.account_m != account_id_m)
+        throw_error("Not your order: " + std::to_string(id));
+
+    ticked_m = true;
+
+    return engine_m.cancel(id, stamp());
+}
+
+/******************************************************************************/
+
+std::vector<order_book_t::value_type> sim_exchange_t::orders() const {
+    lock_t lock{mutex_m};
+
+    return engine_m.orders(account_id_m);
+}
+
+/******************************************************************************/
+
+void sim_exchange_t::levels(levels_t& bids, levels_t& asks) const {
+    lock_t lock{mutex_m};
+
+    engine_m.levels(bids, asks);
+}
+
+/******************************************************************************/
+// Pulls the oldest background order, if it hasn't already traded away.
+
+void sim_exchange_t::cancel_background(timestamp_t ts) {
+    std::size_t id = open_m.front();
+
+    open_m.pop_front();
+
+    if (engine_m.open(id)) {
+        engine_m.cancel(id, ts);
+    }
+}
+
+/******************************************************************************/
+// Every draw from the generator is its own statement: argument evaluation
+// order is unspecified, and the sequence of draws is what makes a run
+// repeatable.
+
+void sim_exchange_t::step() {
+    clock_m += gap_m(random_m);
+
+    timestamp_t ts = stamp();
+    std::size_t roll = action_m(random_m);
+
+    // Drift the fair value a cent at a time; never below a dollar.
+    if (roll < 10) {
+        bool up = coin_m(random_m);
+
+        fair_m = up ? fair_m + 1 : std::max<std::size_t>(fair_m - 1, 100);
+    }
+
+    if (roll < 30 && !open_m.empty()) {
+        cancel_background(ts);
+    } else if (roll < 35) {
+        // Take liquidity: cross the spread and don't stay.
+        bool        buy = coin_m(random_m);
+        std::size_t quantity = size_m(random_m);
+
+        engine_m.submit(bot_account_m,
+                        buy ? direction_t::buy : direction_t::sell,
+                        order_type_t::ioc,
+                        buy ? fair_m + 50 : fair_m - 50,
+                        quantity,
+                        ts);
+    } else {
+        bool        buy = coin_m(random_m);
+        std::size_t offset = offset_m(random_m);
+        std::size_t quantity = size_m(random_m);
+        auto        order = engine_m.submit(bot_account_m,
+                                            buy ? direction_t::buy : direction_t::sell,
+                                            order_type_t::limit,
+                                            buy ? fair_m - offset : fair_m + offset,
+                                            quantity,
+                                            ts);
+
+        if (order.second.open_m)
+            open_m.push_back(order_key_id(order.first));
+
+        if (open_m.size() > max_open_k) {
+            cancel_background(ts);
+        }
+    }
+
+    ticked_m = true;
+
+    ++events_m;
+}
+
+/******************************************************************************/
+// Handlers may trade, which can owe more deliveries; keep going until the
+// strategy has nothing left to react to.
+
+void sim_exchange_t::deliver() {
+    while (ticked_m || !executions_m.empty()) {
+        delivering_m.swap(executions_m);
+
+        if (execution_handler_m) {
+            for (const auto& execution : delivering_m) {
+                execution_handler_m(execution.first, execution.second);
+            }
+        }
+
+        delivering_m.clear();
+
+        if (ticked_m) {
+            ticked_m = false;
+
+            if (tick_handler_m) {
+                tick_handler_m(engine_m.quote());
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+
+void sim_exchange_t::run(std::size_t events) {
+    for (std::size_t i(0); i < events; ++i) {
+        lock_t lock{mutex_m};
+
+        step();
+
+        deliver();
+    }
+}
+
+/******************************************************************************/
+
+std::size_t sim_exchange_t::events() const {
+    lock_t lock{mutex_m};
+
+    return events_m;
+}
+
+/******************************************************************************/
+
+std::uint64_t sim_exchange_t::now() const {
+    lock_t lock{mutex_m};
+
+    return clock_m;
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
@@ -9,14 +9,23 @@
 #include "stock.hpp"
 
 //stdc++
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <thread>
 
 // application
 #include "configuration.hpp"
 #include "curl.hpp"
+#include "curl_multi.hpp"
+#include "histogram.hpp"
+#include "rate_limit.hpp"
 #include "reentrant.hpp"
 #include "require.hpp"
+#include "sim.hpp"
+#include "str.hpp"
+#include "switches.hpp"
 
 /******************************************************************************/
 
@@ -24,14 +33,61 @@ namespace {
 
 /******************************************************************************/
 
-static const std::string api_url_k("https://api.stockfighter.io/ob/api/");
+// The game master's base url. Normally the live service; the settings may
+// point it (and the order book api) at a mock exchange instead.
+const std::string& gm_url() {
+    static const std::string url_s(config::settings().gm_url_m);
+
+    return url_s;
+}
+
+/******************************************************************************/
+
+// HTTP/2 only if it was asked for and our libcurl can actually do it.
+bool use_http2() {
+    static const bool http2_s = config::settings().http2_m &&
+                                curl_t::http2_supported();
+
+    return http2_s;
+}
+
+/******************************************************************************/
+
+curl_pool_t& pool() {
+    static curl_pool_t pool_s([](curl_t& curl) {
+        curl.set_tcp_keepalive();
+        curl.set_header("X-Starfighter-Authorization:" + config::settings().api_key_m);
+
+        if (use_http2()) {
+            curl.set_http2();
+        }
+    });
+
+    return pool_s;
+}
 
 /******************************************************************************/
 
-json_t api_perform(curl_t& curl, bool validate) {
-    curl.set_header("X-Starfighter-Authorization:" + config::settings().api_key_m);
+curl_multi_t& multi() {
+    static curl_multi_t multi_s;
+    static std::once_flag flag_s;
 
-    const std::string& result = curl.perform();
+    std::call_once(flag_s, [](){
+        multi_s.set_multiplexing(use_http2());
+    });
+
+    return multi_s;
+}
+
+/******************************************************************************/
+
+typedef std::function<void (std::exception_ptr, json_t)> api_handler_t;
+
+/******************************************************************************/
+// Turns the result of a completed transfer into json.
+
+json_t api_result(const curl_t& curl, bool validate) {
+    const std::string& result = curl.result();
 
     // HTTP code 204 is no content.
     if (curl.response_code() == 204 && result.empty()) {
@@ -59,27 +115,288 @@ json_t api_perform(curl_t& curl, bool validate) {
 
 /******************************************************************************/
 
-json_t api_get(const std::string& api,
+latency_histogram_t& histogram(stock::endpoint_t endpoint) {
+    static latency_histogram_t histograms_s[stock::endpoint_count_k];
+
+    return histograms_s[static_cast<std::size_t>(endpoint)];
+}
+
+/******************************************************************************/
+
+// The client-side rate limits, one bucket per class of traffic so that (e.g.)
+// a backlog of orders never holds up a cancel.
+token_bucket_t* bucket(stock::endpoint_t endpoint) {
+    static token_bucket_t orders_s(50, 25);
+    static token_bucket_t cancels_s(100, 50);
+    static token_bucket_t polls_s(20, 20);
+    static token_bucket_t books_s(20, 20);
+
+    switch (endpoint) {
+        case stock::endpoint_t::order: return &orders_s;
+        case stock::endpoint_t::cancel: return &cancels_s;
+        case stock::endpoint_t::heartbeat: return &polls_s;
+        case stock::endpoint_t::world: return &polls_s;
+        case stock::endpoint_t::status: return &polls_s;
+        case stock::endpoint_t::book: return &books_s;
+        default: return nullptr; // level management is rare; never hold it up
+    }
+}
+
+/******************************************************************************/
+// How long a request to the endpoint has to wait for its token.
+
+token_bucket_t::duration_t throttle(stock::endpoint_t endpoint) {
+    token_bucket_t* limit = bucket(endpoint);
+
+    return limit ? limit->reserve() : token_bucket_t::duration_t::zero();
+}
+
+/******************************************************************************/
+// Blocks until the endpoint's token comes due. Called before taking a handle
+// from the pool, so a throttled request doesn't keep one from anyone else
+// while it waits.
+
+void wait_for_token(stock::endpoint_t endpoint) {
+    std::this_thread::sleep_for(throttle(endpoint));
+}
+
+/******************************************************************************/
+
+token_bucket_t::duration_t retry_after(const std::string& headers) {
+    std::string lower(str::tolower(headers));
+    std::size_t found = lower.find("retry-after:");
+
+    if (found == std::string::npos)
+        return token_bucket_t::duration_t::zero();
+
+    return std::chrono::seconds(std::atoi(lower.c_str() + found + 12));
+}
+
+/******************************************************************************/
+// Lets the endpoint's bucket know how the venue took the request. Throttling
+// (429) and server trouble (5xx, html error pages, transport failures) back
+// off; anything else - including ordinary "ok": false responses - is a
+// success as far as the rate is concerned.
+
+void feedback(stock::endpoint_t endpoint, const curl_t& curl, bool transferred) {
+    token_bucket_t* limit = bucket(endpoint);
+
+    if (!limit)
+        return;
+
+    std::size_t code = curl.response_code();
+
+    if (!transferred) {
+        limit->penalize();
+    } else if (code == 429 || code >= 500 || curl.result()[0] == '<') {
+        limit->penalize(retry_after(curl.headers()));
+    } else {
+        limit->reward();
+    }
+}
+
+/******************************************************************************/
+// The caller has already waited for the endpoint's token (wait_for_token.)
+
+json_t api_perform(stock::endpoint_t endpoint, curl_t& curl, bool validate) {
+    try {
+        latency_timer_t timer(histogram(endpoint));
+
+        curl.perform();
+    } catch (...) {
+        feedback(endpoint, curl, false);
+
+        throw;
+    }
+
+    feedback(endpoint, curl, true);
+
+    return api_result(curl, validate);
+}
+
+/******************************************************************************/
+// Nonblocking api_perform. handler is called on the io thread with either the
+// json result or the reason there isn't one.
+
+void api_perform_async(stock::endpoint_t     endpoint,
+                       curl_pool_t::handle_t curl,
+                       bool                  validate,
+                       api_handler_t         handler) {
+    typedef latency_timer_t::clock_t clock_t;
+
+    token_bucket_t::duration_t delay(throttle(endpoint));
+    clock_t::time_point        start(clock_t::now() + delay);
+
+    multi().perform_after(delay, std::move(curl), [=](curl_t& curl, std::exception_ptr error) {
+        histogram(endpoint).record(clock_t::now() - start);
+
+        feedback(endpoint, curl, !error);
+
+        json_t json;
+
+        if (!error) {
+            try {
+                json = api_result(curl, validate);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        handler(error, std::move(json));
+    });
+}
+
+/******************************************************************************/
+
+json_t api_get(stock::endpoint_t  endpoint,
+               const std::string& api,
                bool               validate = true) {
-    curl_t curl;
+    wait_for_token(endpoint);
+
+    curl_pool_t::handle_t curl{pool().acquire()};
+
+    curl->set_get();
+    curl->set_url(api);
+
+    return api_perform(endpoint, *curl, validate);
+}
+
+/******************************************************************************/
+
+void api_get_async(stock::endpoint_t  endpoint,
+                   const std::string& api,
+                   bool               validate,
+                   api_handler_t      handler) {
+    curl_pool_t::handle_t curl{pool().acquire()};
+
+    curl->set_get();
+    curl->set_url(api);
+
+    api_perform_async(endpoint, std::move(curl), validate, std::move(handler));
+}
+
+/******************************************************************************/
+// Makes a throwaway request over a specific handle so its connection to the
+// url's host is up (or stays up). Failures are dropped; the next real request
+// will find out soon enough. (It's that handle being warmed, so it waits for
+// its token holding it.)
+
+void warm(stock::endpoint_t endpoint, curl_t& curl, const std::string& url) {
+    try {
+        wait_for_token(endpoint);
+
+        curl.reset();
+        curl.set_get();
+        curl.set_url(url);
+
+        api_perform(endpoint, curl, false);
+    } catch (...) {
+    }
+}
+
+/******************************************************************************/
+// Same as warm, but for the connection cache of the nonblocking engine.
+
+void warm_async(stock::endpoint_t endpoint, const std::string& url) {
+    api_get_async(endpoint, url, false, [](std::exception_ptr, json_t) { });
+}
+
+/******************************************************************************/
+
+// body is the already-serialized json to post.
+json_t api_post_body(stock::endpoint_t  endpoint,
+                     const std::string& api,
+                     const std::string& body,
+                     bool               validate = true) {
+    wait_for_token(endpoint);
 
-    curl.set_url(api);
+    curl_pool_t::handle_t curl{pool().acquire()};
 
-    return api_perform(curl, validate);
+    curl->set_url(api);
+    curl->set_post();
+    curl->set_post_data(body);
+
+    return api_perform(endpoint, *curl, validate);
 }
 
 /******************************************************************************/
 
-json_t api_post(const std::string& api,
+json_t api_post(stock::endpoint_t  endpoint,
+                const std::string& api,
                 const json_t&      parameters = json_t(),
                 bool               validate = true) {
-    curl_t curl;
+    return api_post_body(endpoint, api, parameters.dump(), validate);
+}
+
+/******************************************************************************/
 
-    curl.set_url(api);
-    curl.set_post();
-    curl.set_post_data(parameters.dump());
+void api_post_body_async(stock::endpoint_t  endpoint,
+                         const std::string& api,
+                         const std::string& body,
+                         bool               validate,
+                         api_handler_t      handler) {
+    curl_pool_t::handle_t curl{pool().acquire()};
 
-    return api_perform(curl, validate);
+    curl->set_url(api);
+    curl->set_post();
+    curl->set_post_data(body);
+
+    api_perform_async(endpoint, std::move(curl), validate, std::move(handler));
+}
+
+/******************************************************************************/
+
+void api_post_async(stock::endpoint_t  endpoint,
+                    const std::string& api,
+                    const json_t&      parameters,
+                    bool               validate,
+                    api_handler_t      handler) {
+    api_post_body_async(endpoint, api, parameters.dump(), validate, std::move(handler));
+}
+
+/******************************************************************************/
+// Scratch space for rendering order bodies. set_post_data copies out of it, so
+// one per thread is enough, and its capacity sticks around between orders.
+
+std::string& order_body() {
+    thread_local std::string body_s;
+
+    return body_s;
+}
+
+/******************************************************************************/
+
+void append_uint(std::string& str, std::size_t n) {
+    char  buffer[24];
+    char* last = buffer + sizeof(buffer);
+    char* first = last;
+
+    do {
+        *--first = static_cast<char>('0' + n % 10);
+
+        n /= 10;
+    } while (n);
+
+    str.append(first, last);
+}
+
+/******************************************************************************/
+// Completes a promise from an api handler, running convert on the json first
+// so any validation errors also end up in the promise.
+
+template <typename T, typename F>
+void fulfill(std::promise<T>& promise, std::exception_ptr error, const json_t& json, F convert) {
+    if (!error) {
+        try {
+            promise.set_value(convert(json));
+
+            return;
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    promise.set_exception(error);
 }
 
 /******************************************************************************/
@@ -134,6 +451,34 @@ const char* direction_cast(stock::direction_t type) {
 
 /******************************************************************************/
 
+// true iff the venue's status for an order is ahead of what we have: more of
+// it filled, or closed since. Orders only ever move that way, so a status
+// that's merely different is older than what we have (e.g., an execution
+// that landed after it was fetched), and is no news.
+bool advanced(const stock::order_t& order, const json_t& status) {
+    return order.total_filled_m < static_cast<std::size_t>(status["totalFilled"].int_value()) ||
+           (order.open_m && !status["open"].bool_value());
+}
+
+/******************************************************************************/
+// Fills levels (reusing its capacity) from one side of an orderbook response.
+
+void make_levels(const json_t& json, stock::levels_t& levels) {
+    levels.clear();
+
+    for (const auto& entry : json.array_items()) {
+        stock::level_t level;
+
+        level.price_m = entry["price"].int_value();
+        level.quantity_m = entry["qty"].int_value();
+
+        levels.push_back(level);
+    }
+}
+
+/******************************************************************************/
+#if qAuditHoldings
+
 void update_holding(stock::holdings_t& holdings, const stock::order_t& order) {
     if (order.direction_m == stock::direction_t::buy) {
         holdings.position_m += order.total_filled_m;
@@ -144,6 +489,8 @@ void update_holding(stock::holdings_t& holdings, const stock::order_t& order) {
     }
 }
 
+#endif
+
 /******************************************************************************/
 
 void update_holding(stock::holdings_t& holdings, const stock::ticker_t& quote) {
@@ -164,14 +511,116 @@ namespace stock {
 
 /******************************************************************************/
 
+const std::string& api_url() {
+    static const std::string url_s(config::settings().api_url_m);
+
+    return url_s;
+}
+
+/******************************************************************************/
+
 bool heartbeat() {
-    api_get(api_url_k + "heartbeat");
+    api_get(endpoint_t::heartbeat, api_url() + "heartbeat");
 
     return true;
 }
 
 /******************************************************************************/
 
+void keep_warm() {
+    pool().refresh([](curl_t& curl) {
+        warm(endpoint_t::heartbeat, curl, api_url() + "heartbeat");
+    });
+
+    warm_async(endpoint_t::heartbeat, api_url() + "heartbeat");
+}
+
+/******************************************************************************/
+
+curl_pool_stats_t connection_stats() {
+    return pool().stats();
+}
+
+/******************************************************************************/
+
+const char* transport() {
+    return use_http2() ? "HTTP/2" : "HTTP/1.1";
+}
+
+/******************************************************************************/
+
+std::vector<std::string> rate_limit_report() {
+    std::vector<std::string> result;
+
+    for (endpoint_t endpoint : { endpoint_t::order,
+                                 endpoint_t::cancel,
+                                 endpoint_t::world,
+                                 endpoint_t::book }) {
+        token_bucket_t&   limit = *bucket(endpoint);
+        std::stringstream stream;
+
+        stream << "RATE : " << endpoint_name(endpoint)
+               << " : " << limit.rate() << "/s"
+               << " : PNLT : " << limit.penalties();
+
+        result.push_back(stream.str());
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+const char* endpoint_name(endpoint_t endpoint) {
+    switch (endpoint) {
+        case endpoint_t::order: return "ORDR";
+        case endpoint_t::cancel: return "CNCL";
+        case endpoint_t::heartbeat: return "HRTB";
+        case endpoint_t::world: return "WRLD";
+        case endpoint_t::status: return "STAT";
+        case endpoint_t::book: return "BOOK";
+        case endpoint_t::level: return "LEVL";
+        default: throw_error("unknown endpoint");
+    }
+}
+
+/******************************************************************************/
+
+latency_histogram_t::summary_t latency(endpoint_t endpoint) {
+    return histogram(endpoint).summary();
+}
+
+/******************************************************************************/
+
+std::vector<std::string> latency_report() {
+    std::vector<std::string> result;
+
+    for (std::size_t i(0); i < endpoint_count_k; ++i) {
+        endpoint_t                     endpoint = static_cast<endpoint_t>(i);
+        latency_histogram_t::summary_t summary = latency(endpoint);
+        std::stringstream              stream;
+
+        if (!summary.count_m)
+            continue;
+
+        // microseconds are plenty of resolution for network round trips.
+        stream << "LTNC : " << endpoint_name(endpoint)
+               << " : N : " << summary.count_m
+               << " : P50 : " << summary.p50_m / 1000
+               << " : P99 : " << summary.p99_m / 1000
+               << " : P999 : " << summary.p999_m / 1000
+               << " : MAX : " << summary.max_m / 1000
+               << " : MEAN : " << summary.mean_m / 1000
+               << " (us)";
+
+        result.push_back(stream.str());
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
 void error_check(const json_t& json) {
     const std::string& error = json["error"].string_value();
 
@@ -187,36 +636,233 @@ fill_t make_fill(const json_t& json) {
 
     fill.price_m = json["price"].int_value();
     fill.quantity_m = json["qty"].int_value();
-    fill.ts_m = json["ts"].string_value();
+    fill.ts_m = parse_timestamp(json["ts"].string_value());
 
     return fill;
 }
 
 /******************************************************************************/
 
+fills_t::fills_t(const fills_t& rhs) :
+    storage_m(rhs.begin(), rhs.end()),
+    size_m(rhs.size_m) {
+}
+
+/******************************************************************************/
+
+fills_t::fills_t(fills_t&& rhs) noexcept :
+    storage_m(std::move(rhs.storage_m)),
+    size_m(rhs.size_m) {
+    rhs.size_m = 0;
+}
+
+/******************************************************************************/
+
+fills_t& fills_t::operator=(const fills_t& rhs) {
+    if (this != &rhs) {
+        size_m = 0;
+
+        for (const auto& fill : rhs) {
+            next() = fill;
+        }
+    }
+
+    return *this;
+}
+
+/******************************************************************************/
+
+fills_t& fills_t::operator=(fills_t&& rhs) noexcept {
+    if (this != &rhs) {
+        storage_m = std::move(rhs.storage_m);
+        size_m = rhs.size_m;
+        rhs.size_m = 0;
+    }
+
+    return *this;
+}
+
+/******************************************************************************/
+
+fill_t& fills_t::next() {
+    if (size_m == storage_m.size())
+        storage_m.emplace_back();
+
+    return storage_m[size_m++];
+}
+
+/******************************************************************************/
+// Fibonacci hashing: a venue's order ids are sequential, and the multiply
+// spreads them across the high bits, which pick the bucket.
+
+const order_book_t::bucket_t& order_book_t::bucket(order_key_t key) const {
+    std::size_t mask = index_m.size() - 1;
+    std::size_t i = static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+
+    while (index_m[i].slot_m && index_m[i].key_m != key) {
+        i = (i + 1) & mask;
+    }
+
+    return index_m[i];
+}
+
+order_book_t::bucket_t& order_book_t::bucket(order_key_t key) {
+    return const_cast<bucket_t&>(static_cast<const order_book_t&>(*this).bucket(key));
+}
+
+/******************************************************************************/
+
+void order_book_t::grow() {
+    std::vector<bucket_t> index(std::max<std::size_t>(index_m.size() * 2, 64));
+
+    index_m.swap(index);
+
+    for (const auto& entry : index) {
+        if (entry.slot_m) {
+            bucket(entry.key_m) = entry;
+        }
+    }
+}
+
+/******************************************************************************/
+// Closed orders leave the open list by having the last one swapped into their
+// place.
+
+void order_book_t::update_open(std::uint32_t slot) {
+    std::uint32_t& at = open_at_m[slot];
+    bool           open = orders_m[slot].second.open_m;
+
+    if (open && !at) {
+        open_m.push_back(slot);
+
+        at = static_cast<std::uint32_t>(open_m.size());
+    } else if (!open && at) {
+        std::uint32_t last = open_m.back();
+
+        open_m[at - 1] = last;
+        open_at_m[last] = at;
+        open_m.pop_back();
+
+        at = 0;
+    }
+}
+
+/******************************************************************************/
+// The venue only ever appends fills to an order, so the ones already priced
+// are carried over and only the new ones are added up. An order that comes
+// back with fewer fills than it had is recounted.
+
+void order_book_t::update_holdings(std::uint32_t slot) {
+    const order_t& order = orders_m[slot].second;
+    held_t&        held = held_m[slot];
+
+    if (order.fills_m.size() < held.fills_m) {
+        held.fills_m = 0;
+        held.value_m = 0;
+    }
+
+    for (; held.fills_m < order.fills_m.size(); ++held.fills_m) {
+        const fill_t& fill = order.fills_m[held.fills_m];
+
+        held.value_m += fill.quantity_m * fill.price_m;
+    }
+
+    std::int64_t sign = order.direction_m == direction_t::buy ? 1 : -1;
+    std::int64_t cash = -sign * static_cast<std::int64_t>(held.value_m);
+    std::int64_t position = sign * static_cast<std::int64_t>(order.total_filled_m);
+
+    holdings_m.cash_m += cash - held.cash_m;
+    holdings_m.position_m += position - held.position_m;
+
+    held.cash_m = cash;
+    held.position_m = position;
+}
+
+/******************************************************************************/
+
+void order_book_t::update(std::uint32_t slot) {
+    update_open(slot);
+    update_holdings(slot);
+}
+
+/******************************************************************************/
+
+const order_t* order_book_t::find(order_key_t key) const {
+    if (index_m.empty())
+        return nullptr;
+
+    const bucket_t& found = bucket(key);
+
+    return found.slot_m ? &orders_m[found.slot_m - 1].second : nullptr;
+}
+
+/******************************************************************************/
+
+bool order_book_t::insert(order_key_t key, order_t order) {
+    if ((orders_m.size() + 1) * 2 > index_m.size())
+        grow();
+
+    bucket_t& found = bucket(key);
+
+    if (found.slot_m)
+        return false;
+
+    std::uint32_t slot = static_cast<std::uint32_t>(orders_m.size());
+
+    orders_m.emplace_back(key, std::move(order));
+    open_at_m.push_back(0);
+    held_m.emplace_back();
+
+    found.key_m = key;
+    found.slot_m = slot + 1;
+
+    update(slot);
+
+    return true;
+}
+
+/******************************************************************************/
+
+void order_book_t::assign(order_key_t key, order_t order) {
+    if (!index_m.empty()) {
+        const bucket_t& found = bucket(key);
+
+        if (found.slot_m) {
+            orders_m[found.slot_m - 1].second = std::move(order);
+
+            update(found.slot_m - 1);
+
+            return;
+        }
+    }
+
+    insert(key, std::move(order));
+}
+
+/******************************************************************************/
+
 order_book_t::value_type make_order(const json_t& json) {
-    order_key_t key;
-    order_t     order;
+    order_t order;
 
-    key.first = json["venue"].string_value();
-    key.second = json["id"].int_value();
+    order_key_t key = make_order_key(intern_symbol(json["venue"].string_value()),
+                                     json["id"].int_value());
 
-    order.account_m = json["account"].string_value();
+    order.account_m = intern_symbol(json["account"].string_value());
     order.direction_m = direction_cast(json["direction"].string_value());
     order.open_m = json["open"].bool_value();
     order.type_m = order_type_cast(json["orderType"].string_value());
     order.original_quantity_m = json["originalQty"].int_value();
     order.price_m = json["price"].int_value();
     order.quantity_m = json["qty"].int_value();
-    order.symbol_m = json["symbol"].string_value();
+    order.symbol_m = intern_symbol(json["symbol"].string_value());
     order.total_filled_m = json["totalFilled"].int_value();
-    order.timestamp_m = json["ts"].string_value();
+    order.timestamp_m = parse_timestamp(json["ts"].string_value());
 
     for (const auto& fill : json["fills"].array_items()) {
         order.fills_m.push_back(make_fill(fill));
     }
 
-    return order_book_t::value_type{std::move(key), std::move(order)};
+    return order_book_t::value_type{key, std::move(order)};
 }
 
 /******************************************************************************/
@@ -225,14 +871,14 @@ execution_t make_execution(const json_t& json) {
     execution_t result;
 
     result.order_m = make_order(json["order"]).second;
-    result.account_m = json["account"].string_value();
-    result.venue_m = json["venue"].string_value();
-    result.symbol_m = json["symbol"].string_value();
+    result.account_m = intern_symbol(json["account"].string_value());
+    result.venue_m = intern_symbol(json["venue"].string_value());
+    result.symbol_m = intern_symbol(json["symbol"].string_value());
     result.standing_id_m = json["standingId"].int_value();
     result.incoming_id_m = json["incomingId"].int_value();
     result.price_m = json["price"].int_value();
     result.filled_m = json["filled"].int_value();
-    result.filled_at_m = json["filledAt"].string_value();
+    result.filled_at_m = parse_timestamp(json["filledAt"].string_value());
     result.standing_complete_m = json["standingComplete"].bool_value();
     result.incoming_complete_m = json["incomingComplete"].bool_value();
 
@@ -283,8 +929,49 @@ std::size_t order_t::cash_value() const {
 #endif
 /******************************************************************************/
 
+void order_template_t::render(std::size_t  price,
+                              std::size_t  quantity,
+                              std::string& body) const {
+    body.assign(prefix_m);
+
+    append_uint(body, price);
+
+    body.append(",\"qty\":");
+
+    append_uint(body, quantity);
+
+    body.push_back('}');
+}
+
+/******************************************************************************/
+
+order_template_t make_order_template(const std::string& account,
+                                     const std::string& venue,
+                                     const std::string& symbol,
+                                     direction_t        direction,
+                                     order_type_t       type) {
+    order_template_t result;
+
+    // dump() the strings so they come out quoted and escaped.
+    result.prefix_m = "{\"account\":" + json_t(account).dump() +
+                      ",\"venue\":" + json_t(venue).dump() +
+                      ",\"stock\":" + json_t(symbol).dump() +
+                      ",\"direction\":" + json_t(direction_cast(direction)).dump() +
+                      ",\"orderType\":" + json_t(order_type_cast(type)).dump() +
+                      ",\"price\":";
+
+    return result;
+}
+
+/******************************************************************************/
+#if 0
+#pragma mark -
+#endif
+/******************************************************************************/
+
 void engine_t::start(const std::string& level_name) {
-    json_t json = api_post("https://www.stockfighter.io/gm/levels/" + level_name);
+    json_t json = api_post(endpoint_t::level,
+                           gm_url() + "levels/" + level_name);
 
     account_m = json["account"].string_value();
     seconds_per_day_m = json["secondsPerTradingDay"].int_value();
@@ -303,11 +990,40 @@ void engine_t::start(const std::string& level_name) {
     require(!venue_symbols_m.empty());
 
     require(!stock_symbols_m.empty());
+
+    venue_id_m = intern_symbol(venue());
+    symbol_id_m = intern_symbol(symbol());
+    account_id_m = intern_symbol(account_m);
+
+    build_order_templates();
+}
+
+/******************************************************************************/
+
+void engine_t::simulate(sim_exchange_t& sim) {
+    sim_m = &sim;
+
+    account_m = sim.account();
+    seconds_per_day_m = 5;
+    state_m = "open";
+
+    venue_symbols_m.assign(1, sim.venue());
+    stock_symbols_m.assign(1, sim.symbol());
+
+    venue_id_m = intern_symbol(venue());
+    symbol_id_m = intern_symbol(symbol());
+    account_id_m = intern_symbol(account_m);
+
+    ready_m = true;
 }
 
 /******************************************************************************/
 
 void engine_t::refresh() {
+    if (sim_m) {
+        return;
+    }
+
     static std::atomic<bool> sentry_flag_s{false};
     sentry_t                 sentry{sentry_flag_s};
 
@@ -316,7 +1032,7 @@ void engine_t::refresh() {
     }
 
     // REVISIT : Maybe add a timeout to this specific API call?
-    json_t json = api_get(world_api(id_m));
+    json_t json = api_get(endpoint_t::world, world_api(id_m));
 
     done_m = json["done"].bool_value();
     state_m = json["state"].string_value();
@@ -332,25 +1048,53 @@ void engine_t::refresh() {
 /******************************************************************************/
 
 json_t engine_t::restart(std::size_t id) {
-    return api_post(world_api(id) + "/restart");
+    return api_post(endpoint_t::level, world_api(id) + "/restart");
 }
 
 /******************************************************************************/
 
 json_t engine_t::stop(std::size_t id) {
-    return api_post(world_api(id) + "/stop");
+    return api_post(endpoint_t::level, world_api(id) + "/stop");
 }
 
 /******************************************************************************/
 
 json_t engine_t::resume(std::size_t id) {
-    return api_post(world_api(id) + "/resume");
+    return api_post(endpoint_t::level, world_api(id) + "/resume");
 }
 
 /******************************************************************************/
 
 std::string engine_t::world_api(std::size_t id) {
-    return "https://www.stockfighter.io/gm/instances/" + std::to_string(id);
+    return gm_url() + "instances/" + std::to_string(id);
+}
+
+/******************************************************************************/
+
+void engine_t::warm_up(std::size_t connections) {
+    std::vector<curl_pool_t::handle_t> handles;
+    std::vector<std::thread>           threads;
+
+    // Hold them all at once so the pool has to hand out (and then keep) this
+    // many distinct handles.
+    for (std::size_t i(0); i < connections; ++i) {
+        handles.push_back(pool().acquire());
+    }
+
+    for (auto& handle : handles) {
+        curl_t& curl = *handle;
+
+        threads.emplace_back([=, &curl]() {
+            warm(endpoint_t::heartbeat, curl, api_url() + "heartbeat");
+            warm(endpoint_t::world, curl, world_api(id_m));
+        });
+    }
+
+    warm_async(endpoint_t::heartbeat, api_url() + "heartbeat");
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
 }
 
 /******************************************************************************/
@@ -410,6 +1154,8 @@ bool engine_t::update_ticker(const ticker_t& new_ticker_data,
 
     quote_m.quote_time_m = new_ticker_data.quote_time_m;
 
+    published_quote_m.store(quote_m);
+
     cur_ticker = quote_m;
 
     return true;
@@ -418,28 +1164,108 @@ bool engine_t::update_ticker(const ticker_t& new_ticker_data,
 /******************************************************************************/
 
 ticker_t engine_t::quote() const {
-    lock_t lock{quote_mutex_m};
+    return published_quote_m.load();
+}
+
+/******************************************************************************/
+
+std::size_t engine_t::refresh_depth() {
+    thread_local levels_t bids_s;
+    thread_local levels_t asks_s;
+
+    if (sim_m) {
+        sim_m->levels(bids_s, asks_s);
+    } else {
+        json_t json = api_get(endpoint_t::book,
+                              api_url() + "venues/" + venue() + "/stocks/" + symbol());
+
+        make_levels(json["bids"], bids_s);
+        make_levels(json["asks"], asks_s);
+    }
+
+    lock_t lock{depth_mutex_m};
+
+    return depth_m.apply(bids_s, asks_s);
+}
 
-    return quote_m;
+/******************************************************************************/
+
+depth_book_t engine_t::depth() const {
+    lock_t lock{depth_mutex_m};
+
+    return depth_m;
 }
 
 /******************************************************************************/
 
-void engine_t::update_position(const order_key_t& key,
+void engine_t::update_position(order_key_t        key,
                                const execution_t& execution) {
     // There should be a lot of state validation that happens here.
 
     lock_t lock{book_mutex_m};
 
-    book_m[key] = execution.order_m;
+    book_m.assign(key, execution.order_m);
 }
 
 /******************************************************************************/
 
-bool engine_t::own_order(const order_key_t& key) const {
+std::size_t engine_t::reconcile() {
+    if (sim_m) {
+        // Executions arrive synchronously, so this only catches orders that
+        // changed on the venue without one (e.g., canceled fill-or-kills.)
+        std::size_t result{0};
+
+        for (auto& order : sim_m->orders()) {
+            lock_t         lock{book_mutex_m};
+            const order_t* found = book_m.find(order.first);
+
+            if (found &&
+                found->open_m == order.second.open_m &&
+                found->total_filled_m == order.second.total_filled_m &&
+                found->quantity_m == order.second.quantity_m)
+                continue;
+
+            book_m.assign(order.first, std::move(order.second));
+
+            ++result;
+        }
+
+        return result;
+    }
+
+    const std::string& venue = this->venue();
+    json_t             json = api_get(endpoint_t::status,
+                                      api_url() + "venues/" + venue +
+                                      "/accounts/" + account_m + "/orders");
+    std::size_t        result{0};
+
     lock_t lock{book_mutex_m};
 
-    return book_m.find(key) != book_m.end();
+    // The venue answers with the account's orders in every stock it trades.
+    for (const auto& status : json["orders"].array_items()) {
+        if (intern_symbol(status["symbol"].string_value()) != symbol_id_m)
+            continue;
+
+        order_key_t    key = make_order_key(venue_id_m, status["id"].int_value());
+        const order_t* found = book_m.find(key);
+
+        if (found && !advanced(*found, status))
+            continue;
+
+        book_m.assign(key, make_order(status).second);
+
+        ++result;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+bool engine_t::own_order(order_key_t key) const {
+    lock_t lock{book_mutex_m};
+
+    return book_m.find(key) != nullptr;
 }
 
 /******************************************************************************/
@@ -450,50 +1276,81 @@ holdings_t engine_t::holdings() {
     /* book lock scope */ {
         lock_t lock{book_mutex_m};
 
-        for (const auto& order : book_m) {
-            update_holding(result, order.second);
-        }
-    }
+        result = book_m.holdings();
+
+#if qAuditHoldings
+        holdings_t recount;
 
-    /* quote lock scope */ {
-        lock_t lock{quote_mutex_m};
+        book_m.for_each([&](const order_book_t::value_type& order) {
+            update_holding(recount, order.second);
+        });
 
-        update_holding(result, quote_m);
+        require(recount == result);
+#endif
     }
 
+    update_holding(result, published_quote_m.load());
+
     return result;
 }
 
 /******************************************************************************/
 
-order_book_t::value_type engine_t::order(std::size_t  price,
-                                         std::size_t  quantity,
-                                         order_type_t type,
-                                         direction_t  direction) {
-    const std::string& venue = this->venue();
-    const std::string& symbol = this->symbol();
-
-    json_t parameters = json_t::object {
-        { "account", account_m },
-        { "venue", venue },
-        { "stock", symbol },
-        { "price", static_cast<int>(price) },
-        { "qty", static_cast<int>(quantity) },
-        { "direction", direction_cast(direction) },
-        { "orderType", order_type_cast(type) }
-    };
-
-    json_t                   json{api_post("https://api.stockfighter.io/ob/api/venues/" +
-                                               venue +
-                                               "/stocks/" +
-                                               symbol +
-                                               "/orders",
-                                           parameters)};
-    order_book_t::value_type order = make_order(json);
-
-    require(order.first.first == venue);
-    require(order.second.symbol_m == symbol);
-    require(order.second.account_m == account_m);
+void engine_t::build_order_templates() {
+    order_api_m = api_url() + "venues/" + venue() + "/stocks/" + symbol() + "/orders";
+
+    for (direction_t direction : { direction_t::buy, direction_t::sell }) {
+        for (order_type_t type : { order_type_t::limit,
+                                   order_type_t::market,
+                                   order_type_t::fok,
+                                   order_type_t::ioc }) {
+            order_template(direction, type) = make_order_template(account_m,
+                                                                  venue(),
+                                                                  symbol(),
+                                                                  direction,
+                                                                  type);
+        }
+    }
+}
+
+/******************************************************************************/
+
+order_template_t& engine_t::order_template(direction_t direction, order_type_t type) {
+    return order_templates_m[static_cast<std::size_t>(direction) * 4 +
+                             static_cast<std::size_t>(type)];
+}
+
+/******************************************************************************/
+
+const std::string& engine_t::render_order(std::size_t  price,
+                                          std::size_t  quantity,
+                                          order_type_t type,
+                                          direction_t  direction) {
+    std::string& body = order_body();
+
+    order_template(direction, type).render(price, quantity, body);
+
+    return body;
+}
+
+/******************************************************************************/
+
+order_book_t::value_type engine_t::order_complete(const json_t& json,
+                                                  std::size_t   quantity,
+                                                  order_type_t  type,
+                                                  direction_t   direction) {
+    return order_complete(make_order(json), quantity, type, direction);
+}
+
+/******************************************************************************/
+
+order_book_t::value_type engine_t::order_complete(order_book_t::value_type order,
+                                                  std::size_t              quantity,
+                                                  order_type_t             type,
+                                                  direction_t              direction) {
+    require(order_key_venue(order.first) == venue_id_m);
+    require(order.second.symbol_m == symbol_id_m);
+    require(order.second.account_m == account_id_m);
 
     if (type == order_type_t::limit || type == order_type_t::market) {
         require(order.second.quantity_m + order.second.total_filled_m ==
@@ -505,13 +1362,77 @@ order_book_t::value_type engine_t::order(std::size_t  price,
     require(order.second.direction_m == direction);
 
     lock_t lock{book_mutex_m};
-    book_m.emplace(order);
+    book_m.insert(order.first, order.second);
 
     return order;
 }
 
 /******************************************************************************/
 
+order_book_t::value_type engine_t::order(std::size_t  price,
+                                         std::size_t  quantity,
+                                         order_type_t type,
+                                         direction_t  direction) {
+    if (sim_m) {
+        return order_complete(sim_m->submit(direction, type, price, quantity),
+                              quantity,
+                              type,
+                              direction);
+    }
+
+    json_t json{api_post_body(endpoint_t::order,
+                              order_api_m,
+                              render_order(price, quantity, type, direction))};
+
+    return order_complete(json, quantity, type, direction);
+}
+
+/******************************************************************************/
+
+order_future_t engine_t::order_async(std::size_t     price,
+                                     std::size_t     quantity,
+                                     order_type_t    type,
+                                     direction_t     direction,
+                                     order_handler_t handler) {
+    typedef std::promise<order_book_t::value_type> promise_t;
+
+    std::shared_ptr<promise_t> promise(new promise_t);
+    order_future_t             result(promise->get_future().share());
+
+    // The simulator answers immediately, on this thread.
+    if (sim_m) {
+        try {
+            promise->set_value(order(price, quantity, type, direction));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+
+        if (handler) {
+            handler(result);
+        }
+
+        return result;
+    }
+
+    api_post_body_async(endpoint_t::order,
+                        order_api_m,
+                        render_order(price, quantity, type, direction),
+                        true,
+                        [=](std::exception_ptr error, json_t json) {
+        fulfill(*promise, error, json, [=](const json_t& json) {
+            return order_complete(json, quantity, type, direction);
+        });
+
+        if (handler) {
+            handler(result);
+        }
+    });
+
+    return result;
+}
+
+/******************************************************************************/
+
 order_book_t::value_type engine_t::buy(std::size_t  price,
                                        std::size_t  quantity,
                                        order_type_t type) {
@@ -528,26 +1449,167 @@ order_book_t::value_type engine_t::sell(std::size_t  price,
 
 /******************************************************************************/
 
+order_future_t engine_t::buy_async(std::size_t     price,
+                                   std::size_t     quantity,
+                                   order_type_t    type,
+                                   order_handler_t handler) {
+    return order_async(price, quantity, type, direction_t::buy, std::move(handler));
+}
+
+/******************************************************************************/
+
+order_future_t engine_t::sell_async(std::size_t     price,
+                                    std::size_t     quantity,
+                                    order_type_t    type,
+                                    order_handler_t handler) {
+    return order_async(price, quantity, type, direction_t::sell, std::move(handler));
+}
+
+/******************************************************************************/
+
+std::string engine_t::cancel_api(std::size_t order_id) const {
+    return order_api_m + "/" + std::to_string(order_id) + "/cancel";
+}
+
+/******************************************************************************/
+
 json_t engine_t::cancel_nothrow(std::size_t order_id) {
-    return api_post("https://api.stockfighter.io/ob/api/venues/" +
-                        venue() +
-                        "/stocks/" +
-                        symbol() +
-                        "/orders/" +
-                        std::to_string(order_id) +
-                        "/cancel",
-                    json_t(),
-                    false);
+    return api_post(endpoint_t::cancel, cancel_api(order_id), json_t(), false);
 }
 
 /******************************************************************************/
 
 void engine_t::cancel(std::size_t order_id) {
+    if (sim_m) {
+        order_book_t::value_type order = sim_m->cancel(order_id);
+
+        lock_t lock{book_mutex_m};
+
+        book_m.assign(order.first, std::move(order.second));
+
+        return;
+    }
+
     error_check(cancel_nothrow(order_id));
 }
 
 /******************************************************************************/
 
+cancel_future_t engine_t::cancel_async(std::size_t      order_id,
+                                       cancel_handler_t handler) {
+    typedef std::promise<json_t> promise_t;
+
+    std::shared_ptr<promise_t> promise(new promise_t);
+    cancel_future_t            result(promise->get_future().share());
+
+    // The simulator answers immediately, on this thread. There is no reply
+    // body; the book is already up to date.
+    if (sim_m) {
+        try {
+            cancel(order_id);
+
+            promise->set_value(json_t::object{ { "ok", true } });
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+
+        if (handler) {
+            handler(result);
+        }
+
+        return result;
+    }
+
+    api_post_async(endpoint_t::cancel,
+                   cancel_api(order_id),
+                   json_t(),
+                   true,
+                   [=](std::exception_ptr error, json_t json) {
+        fulfill(*promise, error, json, [](const json_t& json) {
+            return json;
+        });
+
+        if (handler) {
+            handler(result);
+        }
+    });
+
+    return result;
+}
+
+/******************************************************************************/
+
+std::vector<std::size_t> engine_t::open_order_ids() const {
+    std::vector<std::size_t> result;
+
+    lock_t lock{book_mutex_m};
+
+    book_m.for_each_open([&](const order_book_t::value_type& order) {
+        if (order_key_venue(order.first) == venue_id_m) {
+            result.push_back(order_key_id(order.first));
+        }
+    });
+
+    return result;
+}
+
+/******************************************************************************/
+
+cancel_report_t engine_t::cancel_many(const std::vector<std::size_t>& order_ids) {
+    typedef std::chrono::steady_clock clock_t;
+
+    cancel_report_t              result;
+    std::vector<cancel_future_t> replies;
+    clock_t::time_point          start(clock_t::now());
+
+    result.requested_m = order_ids.size();
+
+    replies.reserve(order_ids.size());
+
+    for (std::size_t order_id : order_ids) {
+        replies.push_back(cancel_async(order_id));
+    }
+
+    for (std::size_t i(0); i < replies.size(); ++i) {
+        try {
+            json_t reply = replies[i].get();
+
+            if (sim_m) {
+                ++result.canceled_m;
+
+                continue;
+            }
+
+            order_book_t::value_type order = make_order(reply);
+
+            /* book lock scope */ {
+                lock_t lock{book_mutex_m};
+
+                book_m.assign(order.first, std::move(order.second));
+            }
+
+            ++result.canceled_m;
+        } catch (const std::exception& error) {
+            result.failures_m.emplace_back(order_ids[i], error.what());
+        } catch (...) {
+            result.failures_m.emplace_back(order_ids[i], "unknown");
+        }
+    }
+
+    result.elapsed_m = clock_t::now() - start;
+    result.flat_m = open_order_ids().empty();
+
+    return result;
+}
+
+/******************************************************************************/
+
+cancel_report_t engine_t::cancel_all_open() {
+    return cancel_many(open_order_ids());
+}
+
+/******************************************************************************/
+
 } // namespace stock
 
 /******************************************************************************/
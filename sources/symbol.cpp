@@ -0,0 +1,139 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "symbol.hpp"
+
+// stdc++
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// application
+#include "error.hpp"
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+const std::size_t chunk_size_k = 256;
+const std::size_t chunk_count_k = 256; // every id a symbol_id_t can hold
+const std::size_t cache_size_k = 64; // per thread; a power of two
+
+/******************************************************************************/
+// Names live in fixed chunks that never move once allocated, so symbol_name
+// can read them without the lock: whoever holds an id got it (directly or not)
+// from an intern_symbol that stored the name before returning.
+
+struct table_t {
+    table_t() {
+        add(std::string());
+    }
+
+    stock::symbol_id_t add(std::string name) {
+        std::size_t id = size_m;
+
+        if (id == chunk_size_k * chunk_count_k)
+            throw_error("Symbol table is full");
+
+        std::unique_ptr<std::string[]>& chunk = chunks_m[id / chunk_size_k];
+
+        if (!chunk)
+            chunk.reset(new std::string[chunk_size_k]);
+
+        chunk[id % chunk_size_k] = name;
+
+        ids_m.emplace(std::move(name), static_cast<stock::symbol_id_t>(id));
+
+        ++size_m;
+
+        return static_cast<stock::symbol_id_t>(id);
+    }
+
+    const std::string& name(stock::symbol_id_t id) const {
+        return chunks_m[id / chunk_size_k][id % chunk_size_k];
+    }
+
+    std::mutex                                          mutex_m;
+    std::unordered_map<std::string, stock::symbol_id_t> ids_m;
+    std::unique_ptr<std::string[]>                      chunks_m[chunk_count_k];
+    std::size_t                                         size_m{0};
+};
+
+table_t& symbols() {
+    static table_t symbols_s;
+
+    return symbols_s;
+}
+
+/******************************************************************************/
+// FNV-1a; names are a handful of characters.
+
+inline std::uint32_t hash(const char* first, std::size_t size) {
+    std::uint32_t result(2166136261u);
+
+    for (std::size_t i(0); i < size; ++i) {
+        result = (result ^ static_cast<unsigned char>(first[i])) * 16777619u;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+// The decoders intern every name on every frame, and a process only ever sees
+// a few of them, so each thread remembers the ids it has looked up in a small
+// direct-mapped cache; the lock (and the map) is only for the first sighting.
+
+symbol_id_t intern_symbol(const char* first, std::size_t size) {
+    thread_local symbol_id_t cache_s[cache_size_k]{};
+    thread_local std::string scratch_s;
+
+    if (size == 0)
+        return 0;
+
+    table_t&     table = symbols();
+    symbol_id_t& cached = cache_s[hash(first, size) & (cache_size_k - 1)];
+
+    if (cached) {
+        const std::string& name = table.name(cached);
+
+        if (name.size() == size && std::memcmp(name.data(), first, size) == 0)
+            return cached;
+    }
+
+    scratch_s.assign(first, size);
+
+    std::lock_guard<std::mutex> lock{table.mutex_m};
+    auto                        found = table.ids_m.find(scratch_s);
+
+    cached = found == table.ids_m.end() ? table.add(scratch_s) : found->second;
+
+    return cached;
+}
+
+/******************************************************************************/
+
+const std::string& symbol_name(symbol_id_t id) {
+    return symbols().name(id);
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
@@ -0,0 +1,185 @@
+/******************************************************************************/
+//
+// Copyright 2015 Foster T. Brereton.
+// See license.md in this repository for license details.
+//
+/******************************************************************************/
+
+// identity
+#include "timestamp.hpp"
+
+// stdc++
+#include <chrono>
+#include <cstdio>
+
+/******************************************************************************/
+
+namespace {
+
+/******************************************************************************/
+
+const std::int64_t ns_per_second_k = 1000000000;
+const std::int64_t seconds_per_day_k = 86400;
+
+/******************************************************************************/
+// Days since 1970-01-01 in the proleptic Gregorian calendar, and back. See
+// Howard Hinnant's "chrono-Compatible Low-Level Date Algorithms".
+
+std::int64_t days_from_civil(std::int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+
+    std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned     yoe = static_cast<unsigned>(y - era * 400);
+    unsigned     doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned     doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+void civil_from_days(std::int64_t z, std::int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+
+    std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned     doe = static_cast<unsigned>(z - era * 146097);
+    unsigned     yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned     doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned     mp = (5 * doy + 2) / 153;
+
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+/******************************************************************************/
+
+// Reads count digits at p into value; false if any of them isn't one.
+inline bool digits(const char* p, std::size_t count, unsigned& value) {
+    value = 0;
+
+    for (std::size_t i(0); i < count; ++i) {
+        unsigned digit = static_cast<unsigned char>(p[i]) - '0';
+
+        if (digit > 9)
+            return false;
+
+        value = value * 10 + digit;
+    }
+
+    return true;
+}
+
+/******************************************************************************/
+
+} // namespace
+
+/******************************************************************************/
+
+namespace stock {
+
+/******************************************************************************/
+
+bool parse_timestamp(const char* first, std::size_t size, timestamp_t& result) {
+    // YYYY-MM-DDTHH:MM:SS is 19 characters; then maybe a fraction, then 'Z'.
+    if (size < 20 ||
+        first[4] != '-' || first[7] != '-' || first[10] != 'T' ||
+        first[13] != ':' || first[16] != ':' || first[size - 1] != 'Z')
+        return false;
+
+    unsigned year, month, day, hour, minute, second;
+
+    if (!digits(first, 4, year) ||
+        !digits(first + 5, 2, month) ||
+        !digits(first + 8, 2, day) ||
+        !digits(first + 11, 2, hour) ||
+        !digits(first + 14, 2, minute) ||
+        !digits(first + 17, 2, second) ||
+        month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 60)
+        return false;
+
+    std::int64_t nanos(0);
+    std::size_t  fraction = size - 20;
+
+    if (fraction) {
+        // a '.' and 1 to 9 digits
+        unsigned value;
+
+        if (first[19] != '.' || fraction < 2 || fraction > 10 ||
+            !digits(first + 20, fraction - 1, value))
+            return false;
+
+        nanos = value;
+
+        for (std::size_t i(fraction - 1); i < 9; ++i)
+            nanos *= 10;
+    }
+
+    std::int64_t seconds = days_from_civil(year, month, day) * seconds_per_day_k +
+                           hour * 3600 + minute * 60 + second;
+
+    result = seconds * ns_per_second_k + nanos;
+
+    return true;
+}
+
+/******************************************************************************/
+
+timestamp_t parse_timestamp(const std::string& text) {
+    timestamp_t result(0);
+
+    parse_timestamp(text.data(), text.size(), result);
+
+    return result;
+}
+
+/******************************************************************************/
+
+std::string format_timestamp(timestamp_t timestamp) {
+    if (!timestamp)
+        return std::string();
+
+    // floor division, so times before the epoch come out right too
+    std::int64_t seconds = timestamp / ns_per_second_k;
+    std::int64_t nanos = timestamp % ns_per_second_k;
+
+    if (nanos < 0) {
+        nanos += ns_per_second_k;
+        --seconds;
+    }
+
+    std::int64_t days = seconds / seconds_per_day_k;
+    std::int64_t rest = seconds % seconds_per_day_k;
+
+    if (rest < 0) {
+        rest += seconds_per_day_k;
+        --days;
+    }
+
+    std::int64_t year;
+    unsigned     month, day;
+    char         buffer[64];
+
+    civil_from_days(days, year, month, day);
+
+    std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02uT%02u:%02u:%02u.%09lldZ",
+                  static_cast<long long>(year), month, day,
+                  static_cast<unsigned>(rest / 3600),
+                  static_cast<unsigned>(rest / 60 % 60),
+                  static_cast<unsigned>(rest % 60),
+                  static_cast<long long>(nanos));
+
+    return buffer;
+}
+
+/******************************************************************************/
+
+timestamp_t now_timestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/******************************************************************************/
+
+} // namespace stock
+
+/******************************************************************************/
@@ -16,11 +16,12 @@
 
 // websocketpp
 #include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
 #include <websocketpp/client.hpp>
 
 // application
 #include "error.hpp"
-#include "reentrant.hpp"
+#include "service.hpp"
 #include "switches.hpp"
 
 /******************************************************************************/
@@ -31,7 +32,8 @@ namespace {
 
 namespace ws = websocketpp;
 
-typedef ws::client<ws::config::asio_tls_client> client_t;
+typedef ws::client<ws::config::asio_tls_client> tls_client_t;
+typedef ws::client<ws::config::asio_client>     client_t; // plain ws (e.g., a local mock)
 
 namespace wsstd = ws::lib;
 
@@ -42,13 +44,14 @@ using wsstd::error_code;
 
 typedef ws::config::asio_tls_client::message_type::ptr message_ptr;
 typedef wsstd::shared_ptr<boost::asio::ssl::context>   context_ptr;
+typedef tls_client_t::connection_ptr                   tls_connection_ptr;
 typedef client_t::connection_ptr                       connection_ptr;
 
 /******************************************************************************/
+// https and wss go over TLS; anything else (http, ws) goes in the clear.
 
-boost::asio::io_service& service() {
-    static boost::asio::io_service service_s;
-    return service_s;
+bool secure(const std::string& uri) {
+    return uri.compare(0, 6, "https:") == 0 || uri.compare(0, 4, "wss:") == 0;
 }
 
 /******************************************************************************/
@@ -59,73 +62,43 @@ boost::asio::io_service& service() {
 
 struct websocket_t::impl_t {
     impl_t () {
-#if qDebugOff
-        client_m.set_access_channels(ws::log::alevel::all);
-        client_m.set_error_channels(ws::log::elevel::all);
-#else
-        client_m.set_access_channels(ws::log::alevel::none);
-        client_m.set_error_channels(ws::log::elevel::none);
-#endif
+        init(tls_client_m);
+        init(client_m);
 
-        // Initialize ASIO
-        client_m.init_asio(&service());
+        tls_client_m.set_tls_init_handler(bind(&impl_t::on_tls_init, this, ::_1));
 
-        // Register our handlers
-        client_m.set_tls_init_handler(bind(&impl_t::on_tls_init, this, ::_1));
-
-        client_m.set_open_handler(bind(&impl_t::on_open, this, ::_1));
-        client_m.set_close_handler(bind(&impl_t::on_close, this, ::_1));
-        client_m.set_fail_handler(bind(&impl_t::on_fail, this, ::_1));
-        client_m.set_ping_handler(bind(&impl_t::on_ping, this, ::_1, ::_2));
-        client_m.set_pong_handler(bind(&impl_t::on_pong, this, ::_1, ::_2));
-        client_m.set_pong_timeout_handler(bind(&impl_t::on_pong_timeout, this, ::_1, ::_2));
-        client_m.set_interrupt_handler(bind(&impl_t::on_interrupt, this, ::_1));
-        client_m.set_http_handler(bind(&impl_t::on_http, this, ::_1));
-        client_m.set_validate_handler(bind(&impl_t::on_validate, this, ::_1));
-        client_m.set_message_handler(bind(&impl_t::on_message, this, ::_1, ::_2));
+        // The io thread delivers everything from here on; nothing polls.
+        service::start();
     }
 
     void connect(const std::string& uri) {
-        error_code ec;
-
-        connection_m = client_m.get_connection(uri, ec);
+        secure_m = secure(uri);
 
-        if (ec)
-            throw_error(ec.message());
-
-        client_m.connect(connection_m);
+        if (secure_m) {
+            connect(tls_client_m, tls_connection_m, uri);
+        } else {
+            connect(client_m, connection_m, uri);
+        }
     }
 
     bool connected() const {
-        ws::session::state::value state = connection_m->get_state();
-
-        return state == ws::session::state::connecting ||
-               state == ws::session::state::open;
-    }
-
-    void poll() {
-        static std::atomic<bool> sentry_flag_s{false};
-        sentry_t                 sentry{sentry_flag_s};
-
-        if (!sentry) {
-            return;
-        }
-
-        service().poll();
+        return secure_m ? connected(tls_connection_m) : connected(connection_m);
     }
 
     void disconnect() {
-        client_m.close(connection_m->get_handle(),
-                       ws::close::status::going_away,
-                       "");
-
-        connection_m->terminate(error_code());
+        if (secure_m) {
+            disconnect(tls_client_m, tls_connection_m);
+        } else {
+            disconnect(client_m, connection_m);
+        }
     }
 
     void send_message(const std::string& message) {
-        client_m.send(connection_m->get_handle(),
-                      message,
-                      ws::frame::opcode::text);
+        if (secure_m) {
+            tls_client_m.send(tls_connection_m->get_handle(), message, ws::frame::opcode::text);
+        } else {
+            client_m.send(connection_m->get_handle(), message, ws::frame::opcode::text);
+        }
     }
 
     open_handler_t         open_handler_m;
@@ -145,6 +118,64 @@ struct websocket_t::impl_t {
     impl_t& operator=(const impl_t&) = delete;
     impl_t& operator=(impl_t&&) = delete;
 
+    template <typename Client>
+    void init(Client& client) {
+#if qDebugOff
+        client.set_access_channels(ws::log::alevel::all);
+        client.set_error_channels(ws::log::elevel::all);
+#else
+        client.set_access_channels(ws::log::alevel::none);
+        client.set_error_channels(ws::log::elevel::none);
+#endif
+
+        // Initialize ASIO
+        client.init_asio(&service::io());
+
+        // Register our handlers
+        client.set_open_handler(bind(&impl_t::on_open, this, ::_1));
+        client.set_close_handler(bind(&impl_t::on_close, this, ::_1));
+        client.set_fail_handler(bind(&impl_t::on_fail, this, ::_1));
+        client.set_ping_handler(bind(&impl_t::on_ping, this, ::_1, ::_2));
+        client.set_pong_handler(bind(&impl_t::on_pong, this, ::_1, ::_2));
+        client.set_pong_timeout_handler(bind(&impl_t::on_pong_timeout, this, ::_1, ::_2));
+        client.set_interrupt_handler(bind(&impl_t::on_interrupt, this, ::_1));
+        client.set_http_handler(bind(&impl_t::on_http, this, ::_1));
+        client.set_validate_handler(bind(&impl_t::on_validate, this, ::_1));
+        client.set_message_handler(bind(&impl_t::on_message, this, ::_1, ::_2));
+    }
+
+    template <typename Client, typename Connection>
+    static void connect(Client& client, Connection& connection, const std::string& uri) {
+        error_code ec;
+
+        connection = client.get_connection(uri, ec);
+
+        if (ec)
+            throw_error(ec.message());
+
+        client.connect(connection);
+    }
+
+    template <typename Connection>
+    static bool connected(const Connection& connection) {
+        if (!connection)
+            return false;
+
+        ws::session::state::value state = connection->get_state();
+
+        return state == ws::session::state::connecting ||
+               state == ws::session::state::open;
+    }
+
+    template <typename Client, typename Connection>
+    static void disconnect(Client& client, Connection& connection) {
+        client.close(connection->get_handle(),
+                     ws::close::status::going_away,
+                     "");
+
+        connection->terminate(error_code());
+    }
+
     context_ptr on_tls_init(ws::connection_hdl hdl) {
         context_ptr ctx(new boost::asio::ssl::context(boost::asio::ssl::context::tlsv1));
 
@@ -208,11 +239,14 @@ struct websocket_t::impl_t {
     }
 
     void on_message(ws::connection_hdl hdl, message_ptr msg) {
-        do_handler(message_handler_m, msg->get_payload());
+        do_handler(message_handler_m, std::move(msg->get_raw_payload()));
     }
 
-    client_t       client_m;
-    connection_ptr connection_m;
+    tls_client_t       tls_client_m;
+    client_t           client_m;
+    tls_connection_ptr tls_connection_m;
+    connection_ptr     connection_m;
+    bool               secure_m{true};
 };
 
 /******************************************************************************/
@@ -300,12 +334,6 @@ bool websocket_t::connected() const {
 
 /******************************************************************************/
 
-void websocket_t::poll() {
-    impl_m->poll();
-}
-
-/******************************************************************************/
-
 void websocket_t::disconnect() {
     impl_m->disconnect();
 }